@@ -12,24 +12,36 @@
 
 #include <appopts/appopts-config.h>
 
+//! the section of a configuration file that holds its version
+#define CFG_GROUP_GENERAL "general"
+//! the key in the general section that holds the version of a file
+#define CFG_PERST_VERSION "perst_version"
+
 #if 0
 #    define APPOPTS_DEBUGM printf
 #else
 #    define APPOPTS_DEBUGM black_hole
 #endif
 
-#if 0
-#    define APPOPTS_TRACE_ENTRY printf("APPOPTS ENTRY %s in %s[%d]\n", __func__, __FILE__, __LINE__)
+#ifndef APPOPTS_NO_TRACE
+#    include <appopts/opt_trace.h>
+#    define APPOPTS_TRACE_JOIN2(a, b) a##b
+#    define APPOPTS_TRACE_JOIN(a, b) APPOPTS_TRACE_JOIN2(a, b)
+     //! Times the rest of the enclosing function (see OptTrace).
+#    define APPOPTS_TRACE_ENTRY OptTraceScope appopts_trace_entry_ (__func__)
+     //! Times the rest of the enclosing block under a name, with a detail;
+     //! the detail is only evaluated while a sink is installed.
+#    define APPOPTS_TRACE_SPAN(name, detail) \
+        OptTraceScope APPOPTS_TRACE_JOIN(appopts_trace_span_, __LINE__) (\
+            name, "appopts", \
+            OptTrace::sink () == NULL ? QString () : QString (detail))
 #else
 #    define APPOPTS_TRACE_ENTRY
+#    define APPOPTS_TRACE_SPAN(name, detail)
 #endif
 
-#if 0
-#    define APPOPTS_TRACE_EXIT printf("APPOPTS EXIT %s in %s[%d]\n", __func__, __FILE__, __LINE__)
-#else
-#    define APPOPTS_TRACE_EXIT
-#endif
-
+//! The span started by APPOPTS_TRACE_ENTRY ends with the function.
+#define APPOPTS_TRACE_EXIT
 
 static inline void black_hole (...)
 {}
@@ -11,6 +11,8 @@
 #include "appopts-private.h"
 #include "one_opt.h"
 #include "one_opt_list.h"
+#include "opt_overrides.h"
+#include "opt_validator.h"
 
 #include <usermsg/usermsg.h>
 #include <usermsg/usermsgman.h>
@@ -21,33 +23,105 @@
 #include <QDir>
 #include <QCoreApplication>
 #include <QFile>
+#include <QVector>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QProcessEnvironment>
+
+#include <climits>
 
 /**
  * @class AppOpts
  *
  * This class holds a list of key-value pairs, where values are ultimately
  * list of strings.
+ *
+ * The values are stored in an OptTable (an open-addressing hash table with
+ * precomputed key hashes) that is used by all the getters. The class no
+ * longer derives from `QMap`; code that iterates the options in sorted
+ * order uses `toMap()` or `sortedKeys()`, which are built on demand, so
+ * the setters only pay for the table. The read methods of the former
+ * base (`contains()`, `count()`, `keys()`, `value()` and so on) are
+ * provided on top of the table, and its `insert()` and `remove()` are
+ * deprecated and forward to `setValue()` and `removeValue()`, so the
+ * table and the layers stay consistent.
+ *
+ * Values are also kept per source in an OptLayers instance (defaults,
+ * system, user and local files, command line, runtime changes), so the
+ * origin of each value is known (`valueOrigin()`) and a source can be
+ * replaced or dropped (`replaceLayer()`, `dropLayer()`) without reloading
+ * the others. The table holds the result of resolving the layers.
+ *
+ * Options can also be listed, exported and removed by group
+ * (`keysInGroup()`, `valuesInGroup()`, `exportGroup()`, `removeGroup()`)
+ * through an OptTrie index over the full names, without a scan of all
+ * options. Like the table, the index is append-only: an option that is
+ * removed keeps its key and slot and is skipped because it has no value.
+ *
+ * The instance itself is not thread-safe. For threads that read the options
+ * while another thread changes them use `publish()` (or enable the snapshot
+ * mode with `setSnapshotMode()`) and read through an OptSnapshot::Reader
+ * constructed on `snapshot()`.
  */
 
-#define CFG_GROUP_GENERAL "general"
-#define CFG_PERST_VERSION "perst_version"
-
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
 #define QT_DATA_LOC QStandardPaths::AppDataLocation
 #else
 #define QT_DATA_LOC QStandardPaths::DataLocation
 #endif
 
+//! serializes PerStFactory::create(), which is not documented as thread-safe
+static QMutex perst_factory_lock;
+
+
+//! Runs the locate and parse stage for one file in a worker thread.
+class AppOpts::CfgLoadJob : public QRunnable {
+public:
+    explicit CfgLoadJob (CfgLoad * load) :
+        QRunnable (), load_(load)
+    {}
+    virtual void run () {
+        AppOpts::locateAndParse (*load_);
+    }
+private:
+    CfgLoad * load_;
+};
 
 /* ------------------------------------------------------------------------- */
 /**
  * Creates a valid instance.
  */
-AppOpts::AppOpts() : QMap<QString,QStringList>(),
+AppOpts::AppOpts() :
+    table_(),
+    snapshot_(),
+    snapshot_mode_(false),
+    batch_depth_(0),
+    batch_changed_(false),
+    txn_open_(false),
+    txn_order_(),
+    txn_values_(),
+    parallel_load_(false),
+    bin_cache_(false),
+    lazy_load_(false),
+    lazy_absent_(),
+    known_(),
+    known_index_(),
+    layers_(),
+    watcher_(NULL),
+    reload_listeners_(),
+    saver_(NULL),
+    trie_(),
+    trie_slots_(0),
+    metrics_(NULL),
+    changes_(NULL),
     system_file_(NULL),
     user_file_(NULL),
     local_file_(NULL),
-    current_file_(NULL)
+    current_file_(NULL),
+    current_cfg_(-1)
 {
     APPOPTS_TRACE_ENTRY;
 
@@ -62,14 +136,30 @@ AppOpts::AppOpts() : QMap<QString,QStringList>(),
 AppOpts::~AppOpts()
 {
     APPOPTS_TRACE_ENTRY;
+    if (saver_ != NULL) {
+        delete saver_;
+        saver_ = NULL;
+    }
+    if (watcher_ != NULL) {
+        delete watcher_;
+        watcher_ = NULL;
+    }
+    if (metrics_ != NULL) {
+        delete metrics_;
+        metrics_ = NULL;
+    }
+    if (changes_ != NULL) {
+        delete changes_;
+        changes_ = NULL;
+    }
+
+    for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+        resetBinCache (cfg);
+    }
+
     if (current_file_ != NULL) {
-        if (
-                (current_file_ != system_file_) &&
-                (current_file_ != user_file_) &&
-                (current_file_ != local_file_)) {
-            delete current_file_;
-            current_file_ = NULL;
-        }
+        delete current_file_;
+        current_file_ = NULL;
     }
 
     if (system_file_ != NULL) {
@@ -116,7 +206,19 @@ QString AppOpts::cfgFileName (const QString & s_app_name)
  *
  * The name that results is then used to search for a configuration file
  * in three locations: system data directory, user home directory and
- * current directory. If found, the file is immediately loaded in this order.
+ * current directory. If found, the file is loaded; values from more
+ * specific files (current dir over user home over system data) win.
+ *
+ * When parallel loading is enabled (see `setParallelLoad()`) the three
+ * files are located and parsed concurrently. The results are then merged
+ * in the same order as in the sequential case, so the outcome does not
+ * depend on which file finished first. The time spent in each stage
+ * is reported through the debug channel of \b um.
+ *
+ * When binary caches are enabled (see `setBinaryCache()`) a file that
+ * has a fresh cache is not parsed; the values are taken from the cache
+ * and the file is only parsed the first time an option that the cache
+ * does not know about is looked up.
  *
  * The reverse order (current dir, user home, system data) is used to decide
  * where to save changed settings.
@@ -127,7 +229,9 @@ QString AppOpts::cfgFileName (const QString & s_app_name)
  */
 bool AppOpts::loadFromAll (UserMsg & um, const QString & s_app_name)
 {
+    APPOPTS_TRACE_SPAN("loadFromAll", s_app_name);
     bool b_ret = true;
+    beginBatch ();
     for (;;) {
 
         //! Get the name of the config file
@@ -141,103 +245,374 @@ bool AppOpts::loadFromAll (UserMsg & um, const QString & s_app_name)
         um.addDbgInfo (QString("Looking for a config file named %1.")
                        .arg (s_file_name));
 
-        // look for a config file in data location
-        QString s_file_system = QStandardPaths::locate (
-                    QT_DATA_LOC,
-                    s_file_name,
-                    QStandardPaths::LocateFile);
-        if (!s_file_system.isEmpty ()) {
-            bool b_tmp = loadFile (s_file_system, &system_file_, um);
-            um.addDbgInfo (QString("Located general config file %1; load result: %2.")
-                           .arg (s_file_system)
-                           .arg (b_tmp ? "loaded" : "failed"));
-            b_ret = b_ret & b_tmp;
+        // locate and parse the files
+        CfgLoad loads[CfgFileCount];
+        for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+            loads[cfg].cfg_ = cfg;
+            loads[cfg].s_file_name_ = s_file_name;
+            loads[cfg].perst_ = NULL;
+            loads[cfg].use_cache_ = bin_cache_;
+            loads[cfg].cache_ = NULL;
+            loads[cfg].locate_ns_ = 0;
+            loads[cfg].parse_ns_ = 0;
         }
-
-        // look for a config file in home location
-        QString s_file_user = QStandardPaths::locate (
-                    QStandardPaths::HomeLocation,
-                    s_file_name,
-                    QStandardPaths::LocateFile);
-        if (!s_file_user.isEmpty () && (s_file_user != s_file_system)) {
-            bool b_tmp = loadFile (s_file_user, &system_file_, um);
-            um.addDbgInfo (QString("Located user config file %1; load result: %2.")
-                           .arg (s_file_system)
-                           .arg (b_tmp ? "loaded" : "failed"));
-            b_ret = b_ret & b_tmp;
+        if (parallel_load_) {
+            QThreadPool pool;
+            pool.setMaxThreadCount (CfgFileCount);
+            for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+                pool.start (new CfgLoadJob (&loads[cfg]));
+            }
+            pool.waitForDone ();
+        } else {
+            for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+                locateAndParse (loads[cfg]);
+            }
         }
 
-        // read local configuration
-        QDir d_crt (QDir::current ());
-        QString s_file_local = d_crt.absoluteFilePath (s_file_name);
-        if (QFile::exists (s_file_local)) {
-            if ((s_file_local != s_file_system) &&
-                    (s_file_local != s_file_user)) {
+        // the same file may be found in more than one location
+        if (loads[UserCfg].s_path_ == loads[SystemCfg].s_path_) {
+            discardLoad (loads[UserCfg]);
+        }
+        if ((loads[LocalCfg].s_path_ == loads[SystemCfg].s_path_) ||
+                (loads[LocalCfg].s_path_ == loads[UserCfg].s_path_)) {
+            discardLoad (loads[LocalCfg]);
+        }
 
-                bool b_tmp = loadFile (s_file_local, &local_file_, um);
+        // merge, least specific first
+        static const char * const cfg_msgs[CfgFileCount] = {
+            "Located general config file %1; load result: %2.",
+            "Located user config file %1; load result: %2.",
+            "Current dir config file %1; load result: %2."
+        };
+        static const char * const cfg_names[CfgFileCount] = {
+            "system", "user", "local"
+        };
+        for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+            CfgLoad & load = loads[cfg];
+            um.addDbgInfo (QString("Config layer %1: locate %2 ms, parse %3 ms.")
+                           .arg (cfg_names[cfg])
+                           .arg (load.locate_ns_ / 1000000.0)
+                           .arg (load.parse_ns_ / 1000000.0));
+            if (load.s_path_.isEmpty ())
+                continue;
 
-                um.addDbgInfo (QString("Current dir config file %1; load result: %2.")
-                               .arg (s_file_system)
-                               .arg (b_tmp ? "loaded" : "failed"));
-                b_ret = b_ret & b_tmp;
-            }
+            bool b_tmp = applyLoad (load, um);
+            um.addDbgInfo (QString(cfg_msgs[cfg])
+                           .arg (load.s_path_)
+                           .arg (b_tmp ? "loaded" : "failed"));
+            b_ret = b_ret & b_tmp;
         }
 
         // select where we will save changes
         QString s_save;
-        if (local_file_ != NULL) {
-            current_file_ = local_file_;
+        int current_cfg = -1;
+        if (hasCfgFile (LocalCfg)) {
+            current_cfg = LocalCfg;
             s_save = "current dir";
-        } else if (user_file_ != NULL) {
-            current_file_ = user_file_;
+        } else if (hasCfgFile (UserCfg)) {
+            current_cfg = UserCfg;
             s_save = "user home";
-        } else if (system_file_ != NULL) {
-            current_file_ = system_file_;
+        } else if (hasCfgFile (SystemCfg)) {
+            current_cfg = SystemCfg;
             s_save = "system data";
         }
         if (s_save.isEmpty()) {
             um.addDbgInfo (QString ("Changes will NOT be saved because no config file was found"));
         } else {
+            delete current_file_;
+            current_file_ = NULL;
+            current_cfg_ = current_cfg;
             um.addDbgInfo (QString ("Changes will be saved in %1 file: %2")
                            .arg (s_save)
-                           .arg (current_file_->location()));
+                           .arg (currentLocation ()));
+        }
+
+        if (watcher_ != NULL) {
+            watchCfgFiles ();
         }
 
         break;
     }
+    endBatch ();
     return b_ret;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
 /**
- * Creates a PerSt instance from our file and checks that a `general`
- * section exists and it contains a proper `perst_version` version
- * string that we are safe to interpret.
+ * Looks for the file in the location that corresponds to `load.cfg_`
+ * and, if found, parses it. The method only touches \b load, so the three
+ * files may be processed in parallel.
+ *
+ * @param load input (kind and file name) and output of the stage
+ */
+void AppOpts::locateAndParse (CfgLoad & load)
+{
+    QElapsedTimer timer;
+    timer.start ();
+    load.s_path_ = locateCfgFile (load.cfg_, load.s_file_name_);
+    load.locate_ns_ = timer.nsecsElapsed ();
+
+    if (!load.s_path_.isEmpty ()) {
+        timer.restart ();
+        load.perst_ = openCfgFile (
+                    load.s_path_, load.use_cache_, &load.source_,
+                    &load.s_version_, &load.s_error_, &load.cache_);
+        load.parse_ns_ = timer.nsecsElapsed ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The system file is searched in the data directories of the application,
+ * the user file in the home directory and the local file in the current
+ * directory.
+ *
+ * @param cfg one of the CfgFile values
+ * @param s_file_name name of the file, without a path
+ * @return the path of the file or an empty string if it was not found
+ */
+QString AppOpts::locateCfgFile (int cfg, const QString & s_file_name)
+{
+    static const char * const cfg_names[CfgFileCount] = {
+        "system", "user", "local"
+    };
+    APPOPTS_TRACE_SPAN("locate", QString (cfg_names[cfg]));
+    QString result;
+    switch (cfg) {
+    case SystemCfg:
+        result = QStandardPaths::locate (
+                    QT_DATA_LOC,
+                    s_file_name,
+                    QStandardPaths::LocateFile);
+        break;
+    case UserCfg:
+        result = QStandardPaths::locate (
+                    QStandardPaths::HomeLocation,
+                    s_file_name,
+                    QStandardPaths::LocateFile);
+        break;
+    case LocalCfg: {
+        QDir d_crt (QDir::current ());
+        QString s_file_local = d_crt.absoluteFilePath (s_file_name);
+        if (QFile::exists (s_file_local)) {
+            result = s_file_local;
+        }
+        break; }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Used for a file that was already found in a less specific location.
+ *
+ * @param load the stage to discard
+ */
+void AppOpts::discardLoad (CfgLoad & load)
+{
+    delete load.perst_;
+    load.perst_ = NULL;
+    delete load.cache_;
+    load.cache_ = NULL;
+    load.s_path_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The parsed file (or its binary cache) becomes the system, user or local
+ * file of this instance and its version is checked in the same way as
+ * `loadFile()` does. A file that was loaded before in the same place
+ * (by a previous `loadFromAll()`) is released.
+ *
+ * @param load a stage that was processed by `locateAndParse()`
+ * @param um communication object; the parse error is reported here
+ * @return true if the file or its cache can be used
+ */
+bool AppOpts::applyLoad (CfgLoad & load, UserMsg & um)
+{
+    PerSt ** slot = cfgSlot (load.cfg_);
+    delete *slot;
+    *slot = load.perst_;
+    lazy_absent_.clear ();
+    resetBinCache (load.cfg_);
+    if ((load.perst_ == NULL) && (load.cache_ == NULL)) {
+        um.addErr (QString ("Config file %1 could not be used: %2")
+                   .arg (load.s_path_)
+                   .arg (load.s_error_));
+        return false;
+    }
+    load.perst_ = NULL;
+
+    if (load.use_cache_) {
+        BinCacheState & st = bin_state_[load.cfg_];
+        st.cache_ = load.cache_;
+        st.path_ = load.s_path_;
+        st.source_ = load.source_;
+        st.version_ = load.s_version_;
+        load.cache_ = NULL;
+        um.addDbgInfo (QString (st.cache_ == NULL ?
+                                    "No fresh binary cache for %1." :
+                                    "Using binary cache for %1.")
+                       .arg (load.s_path_));
+    }
+
+    APPOPTS_TRACE_SPAN("versionCheck", load.s_path_);
+    if (!load.s_version_.isEmpty ()) {
+        storeValue (CFG_PERST_VERSION, QStringList (load.s_version_));
+    }
+
+    // the only valid version right now is ours
+    if (load.s_version_ != APPOPTS_VERSION_STRING) {
+        um.addErr (
+                   QString("The version of the file (%1) differs from supported version (%2).")
+                   .arg (load.s_version_)
+                   .arg (APPOPTS_VERSION_STRING));
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * By default the files are processed one after another.
+ *
+ * Only the creation of the PerSt instances is serialized (see
+ * `parseCfgFile()`); locating the files, opening their binary caches and
+ * reading their versions run concurrently.
+ *
+ * @param b_enable true to locate and parse the files concurrently
+ */
+void AppOpts::setParallelLoad (bool b_enable)
+{
+    parallel_load_ = b_enable;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates a PerSt instance from a file and reads the `perst_version`
+ * value from its `general` section. This method does not change any
+ * instance and may be used from any thread.
+ *
+ * PerStFactory keeps no promise about being used from several threads,
+ * so the calls to `PerStFactory::create()` made by `loadFromAll()` in
+ * parallel mode and by the reload jobs of OptWatcher are serialized by a
+ * lock; the instance that is returned is only used by the caller.
  *
  * @param s_file Input file's path.
- * @param out_pers Resulted PerSt object, if any.
- * @param um communication device.
- * @return true if everything went fine.
+ * @param s_version receives the version string (may be empty)
+ * @param s_error receives a description of the error, if any
+ * @return the new PerSt instance or NULL if the file could not be used
  */
-bool AppOpts::loadFile (const QString & s_file, PerSt ** out_pers,
-                        UserMsg & um)
+PerSt * AppOpts::parseCfgFile (
+        const QString & s_file, QString * s_version, QString * s_error)
 {
-    PerSt * user_file = NULL;
+    PerSt * result = NULL;
     bool b_ret = false;
     for (;;) {
 
         // parse the file
-        user_file = PerStFactory::create ("config", s_file);
-        if (user_file == NULL) break;
+        {
+            QMutexLocker lock (&perst_factory_lock);
+            result = PerStFactory::create ("config", s_file);
+        }
+        if (result == NULL) {
+            *s_error = QObject::tr("The file could not be parsed.");
+            break;
+        }
 
-        b_ret = user_file->beginGroup (CFG_GROUP_GENERAL);
-        if (!b_ret) break;
+        b_ret = result->beginGroup (CFG_GROUP_GENERAL);
+        if (!b_ret) {
+            *s_error = QObject::tr("The file has no general section.");
+            break;
+        }
 
         // read the version
-        QString s_version = user_file->valueS (CFG_PERST_VERSION);
+        *s_version = result->valueS (CFG_PERST_VERSION);
+
+        b_ret = result->endGroup (CFG_GROUP_GENERAL);
+        if (!b_ret) {
+            *s_error = QObject::tr("The file has no general section.");
+            break;
+        }
+
+        b_ret = true;
+        break;
+    }
+
+    if (!b_ret) {
+        delete result;
+        result = NULL;
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If \b b_use_cache is true and the file has a fresh binary cache the
+ * file is not parsed: the version is taken from the cache, NULL is
+ * returned and the PerSt instance is created by `cfgFile()` once an
+ * option that is missing from the cache is looked up. The checks
+ * performed by `parseCfgFile()` are not repeated in this case: caches
+ * are only written for files that passed them, and a cache is only
+ * fresh while the file is unchanged.
+ *
+ * @param s_file Input file's path.
+ * @param b_use_cache look for a binary cache
+ * @param source receives the identity of the file if \b b_use_cache
+ * @param s_version receives the version string (may be empty)
+ * @param s_error receives a description of the error, if any
+ * @param out_cache receives the cache or NULL
+ * @return the new PerSt instance or NULL if the file was not parsed
+ */
+PerSt * AppOpts::openCfgFile (
+        const QString & s_file, bool b_use_cache, OptBinCache::Source * source,
+        QString * s_version, QString * s_error, OptBinCache ** out_cache)
+{
+    APPOPTS_TRACE_SPAN("parse", s_file);
+    *out_cache = NULL;
+    if (b_use_cache && OptBinCache::identify (s_file, source)) {
+        OptBinCache * cache = OptBinCache::open (s_file, *source);
+        if (cache != NULL) {
+            *s_version = cache->version ();
+            *out_cache = cache;
+            return NULL;
+        }
+    }
+    return parseCfgFile (s_file, s_version, s_error);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates a PerSt instance from our file and checks that a `general`
+ * section exists and it contains a proper `perst_version` version
+ * string that we are safe to interpret. The file is always parsed,
+ * as the caller receives the PerSt instance; binary caches are only
+ * used for the system, user and local files.
+ *
+ * @param s_file Input file's path.
+ * @param out_pers Resulted PerSt object, if any.
+ * @param um communication device.
+ * @return true if everything went fine.
+ */
+bool AppOpts::loadFile (const QString & s_file, PerSt ** out_pers,
+                        UserMsg & um)
+{
+    APPOPTS_TRACE_SPAN("loadFile", s_file);
+    QString s_version;
+    QString s_error;
+    PerSt * user_file = parseCfgFile (s_file, &s_version, &s_error);
+    bool b_ret = (user_file != NULL);
+    if (b_ret) {
+        APPOPTS_TRACE_SPAN("versionCheck", s_file);
         if (!s_version.isEmpty ()) {
-            this->insert (CFG_PERST_VERSION, QStringList (s_version));
+            storeValue (CFG_PERST_VERSION, QStringList (s_version));
         }
 
         // the only valid version right now is ours
@@ -247,17 +622,10 @@ bool AppOpts::loadFile (const QString & s_file, PerSt ** out_pers,
                        .arg (s_version)
                        .arg (APPOPTS_VERSION_STRING));
         }
-
-        b_ret = user_file->endGroup (CFG_GROUP_GENERAL);
-        if (!b_ret) break;
-
-        b_ret = true;
-        break;
-    }
-
-    if (!b_ret) {
-        delete user_file;
-        user_file = NULL;
+    } else {
+        um.addErr (QString ("Config file %1 could not be used: %2")
+                   .arg (s_file)
+                   .arg (s_error));
     }
 
     if (out_pers != NULL) {
@@ -280,30 +648,61 @@ bool AppOpts::loadFile (const QString & s_file, PerSt ** out_pers,
  *
  * @note Default value is not used if the variable is not found.
  *
- * @param perst the object to search (can be NULL)
+ * The value only goes into the layer of the file; the caller
+ * materializes the option once all the files were read
+ * (see `materializeCfgValue()`).
+ *
+ * @param cfg   one of the CfgFile values
  * @param opt   definition of the variable to search
+ * @param rec   receives what the file knows about the option
  * @param um    communication object
  * @return true if the variable was found
  */
-bool AppOpts::readValueFromPerSt (
-        PerSt * perst, const OneOpt & opt, UserMsg & um)
+bool AppOpts::readValueFromCfg (
+        int cfg, const OneOpt & opt,
+        OptBinCache::Record & rec, UserMsg & um)
 {
     bool b_ret = false;
-    APPOPTS_TRACE_ENTRY;
+    APPOPTS_TRACE_SPAN("readOption", opt.fullName ());
+
+    if (hasCfgFile (cfg)) {
+        b_ret = lookupCfgValue (cfg, opt, rec);
+        setCfgLayer (cfg, opt.fullName (), rec);
+        if (b_ret) {
+            um.addDbgInfo( (QString (
+                                "Option %1 found in "
+                                "configuration file %2.")
+                            .arg(opt.name_)
+                            .arg(cfgLocation (cfg))));
+        }
+    }
+
+    return b_ret;
+}
+/* ========================================================================= */
 
+/* ------------------------------------------------------------------------- */
+/**
+ * The method honors option's group. It does not change any instance
+ * and may be used from any thread, as long as the PerSt instance is not
+ * used by another thread at the same time.
+ *
+ * @param perst the object to search (can be NULL)
+ * @param opt   definition of the variable to search
+ * @param sl_out receives the value
+ * @return true if the variable was found
+ */
+bool AppOpts::valueFromPerSt (
+        PerSt * perst, const OneOpt & opt, QStringList & sl_out)
+{
+    bool b_ret = false;
     if (perst != NULL) {
         if (!opt.group_.isEmpty()) {
             perst->beginGroup (opt.group_);
         }
 
         if (perst->hasKey (opt.name_)) {
-            QStringList sl = perst->valueSList (opt.name_);
-            insert (opt.fullName(), sl);
-            um.addDbgInfo( (QString (
-                                "Option %1 found in "
-                                "configuration file %2.")
-                            .arg(opt.name_)
-                            .arg(perst->location())));
+            sl_out = perst->valueSList (opt.name_);
             b_ret = true;
         }
 
@@ -311,8 +710,6 @@ bool AppOpts::readValueFromPerSt (
             perst->endGroup (opt.group_);
         }
     }
-
-    APPOPTS_TRACE_EXIT;
     return b_ret;
 }
 /* ========================================================================= */
@@ -322,11 +719,16 @@ bool AppOpts::readValueFromPerSt (
  * The method will honor variable's group and try to locate the value
  * in system, user and local config files (represented as persistent storage
  * inside).
- * If found the variable and the value are inserted into local storage,
- * replacing any value that was previously there.
+ * Each file that has the variable sets it in the layer of that file
+ * (see OptLayers); the value that is stored is the one of the most
+ * specific layer, so a value set at runtime with `setValue()` or given
+ * on the command line still wins over the files.
  *
  * If a variable is not required and is also not found in the configuration
- * files the default value is used.
+ * files the default value is used, unless a more specific layer has one.
+ *
+ * The definition is remembered and used when a file is reloaded
+ * (see `setHotReload()`).
  *
  * @param opt   definition of the variable to search
  * @param um    communication object
@@ -336,29 +738,23 @@ bool AppOpts::readValueFromCfgs (const OneOpt & opt, UserMsg & um)
 {
     APPOPTS_TRACE_ENTRY;
 
-    bool b_ret = false;
-    for (;;) {
-
-        b_ret = b_ret | readValueFromPerSt (system_file_, opt, um);
-        b_ret = b_ret | readValueFromPerSt (user_file_, opt, um);
-        b_ret = b_ret | readValueFromPerSt (local_file_, opt, um);
+    rememberOpt (opt);
 
-        if (!b_ret) {
-            if (opt.required_) {
-                um.addErr (QString (
-                               "Required option %1 not present in "
-                               "configuration file(s).")
-                           .arg (opt.name_));
-                b_ret = false;
-            } else {
-                QStringList sl = opt.default_;
-                insert (opt.fullName(), sl);
-            }
-        } else {
+    bool b_ret = false;
+    int found_cfg = -1;
+    OptBinCache::Record found_rec = OptBinCache::absentRecord ();
+    for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+        OptBinCache::Record rec = OptBinCache::absentRecord ();
+        if (readValueFromCfg (cfg, opt, rec, um)) {
             b_ret = true;
+            found_cfg = cfg;
+            found_rec = rec;
         }
+    }
+    materializeCfgValue (opt, found_cfg, found_rec);
 
-        break;
+    if (!b_ret) {
+        b_ret = useDefault (opt, um);
     }
 
     APPOPTS_TRACE_EXIT;
@@ -368,17 +764,71 @@ bool AppOpts::readValueFromCfgs (const OneOpt & opt, UserMsg & um)
 
 /* ------------------------------------------------------------------------- */
 /**
- * The method simply iterates the list of options and uses
- * `readValueFromCfgs()` to get their values and insert them into its own
- * option tree.
+ * The definition is used when a file is reloaded; a previous definition
+ * with the same full name is replaced. The default value of an option
+ * that is not required goes into the default layer.
+ *
+ * @param opt definition of the variable
+ */
+void AppOpts::rememberOpt (const OneOpt & opt)
+{
+    QString s_full_name = opt.fullName();
+    if (opt.required_) {
+        layers_.removeValue (OptLayers::DefaultLayer, s_full_name);
+    } else {
+        layers_.setValue (OptLayers::DefaultLayer, s_full_name, opt.default_);
+    }
+    QHash<QString,int>::const_iterator known = known_index_.constFind (s_full_name);
+    if (known == known_index_.constEnd ()) {
+        known_index_.insert (s_full_name, known_.count ());
+        known_.append (opt);
+    } else {
+        known_[known.value ()] = opt;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called for a variable that was not found in any file. A required variable
+ * results in an error, otherwise the default value (already in the default
+ * layer and materialized with the other options) is used, unless a more
+ * specific layer provides a value.
+ *
+ * @param opt definition of the variable
+ * @param um communication object
+ * @return false if the variable was required
+ */
+bool AppOpts::useDefault (const OneOpt & opt, UserMsg & um)
+{
+    if (opt.required_) {
+        um.addErr (QString (
+                       "Required option %1 not present in "
+                       "configuration file(s).")
+                   .arg (opt.name_));
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The result is the same as calling `readValueFromCfgs()` for each option
+ * in the list, but each file is walked only once: options are grouped by
+ * their group and each group is entered a single time per file.
  *
  * This is useful if the application defines at startup a list of options
  * that it expects, then initializes the AppOpts instance and makes sure
  * that all required options are present.
  *
+ * The values of options that have constraints (see OneOpt::constraints())
+ * are then checked in one pass and all problems are reported.
+ *
  * @param list the list of variables to search
  * @param um communication object
- * @return true if all required variables were found
+ * @return true if all required variables were found and all values
+ *         satisfy their constraints
  */
 bool AppOpts::readMultipleFromCfgs (const OneOptList & list, UserMsg & um)
 {
@@ -386,10 +836,40 @@ bool AppOpts::readMultipleFromCfgs (const OneOptList & list, UserMsg & um)
 
     bool b_ret = true;
 
-    foreach (const OneOpt & opt, list) {
-        b_ret = b_ret & readValueFromCfgs (opt, um);
+    beginBatch ();
+
+    // group the definitions
+    QMap<QString, QList<int> > groups;
+    int i_max = list.count ();
+    for (int i = 0; i < i_max; ++i) {
+        const OneOpt & opt = list.at (i);
+        rememberOpt (opt);
+        groups[opt.group_].append (i);
+    }
+
+    // one pass over each file, least specific first; only the layers change
+    QVector<int> found (i_max, -1);
+    QVector<OptBinCache::Record> recs (i_max, OptBinCache::absentRecord ());
+    for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+        readGroupsFromCfg (cfg, list, groups, found, recs, um);
+    }
+
+    // then each option is stored once
+    for (int i = 0; i < i_max; ++i) {
+        materializeCfgValue (list.at (i), found.at (i), recs.at (i));
+        if (found.at (i) == -1) {
+            b_ret = b_ret & useDefault (list.at (i), um);
+        }
+    }
+
+    endBatch ();
+
+    if (bin_cache_) {
+        writeBinaryCaches (um);
     }
 
+    b_ret = b_ret & validate (list, um);
+
     APPOPTS_TRACE_EXIT;
     return b_ret;
 }
@@ -397,25 +877,160 @@ bool AppOpts::readMultipleFromCfgs (const OneOptList & list, UserMsg & um)
 
 /* ------------------------------------------------------------------------- */
 /**
- * The class represents values for options as a list of strings. This
- * overload will create a list with a single member and use that as a value.
- *
- * Any value that was previously assigned to this option will be overwritten.
+ * The constraints are compiled for this call only; applications that
+ * check the same list more than once should build an OptValidator and
+ * use the other overload.
  *
- * @param s_key the name of the variable to change
- * @param s_value a string value to use
+ * @param list the definitions of the options
+ * @param um communication object
+ * @return true if all the values are acceptable
  */
-void AppOpts::setValue (
-        const QString & s_key, const QString & s_value)
+bool AppOpts::validate (const OneOptList & list, UserMsg & um) const
 {
-    insert (s_key, QStringList(s_value));
+    OptValidator validator (list);
+    if (validator.count () == 0)
+        return true;
+    return validate (validator, um);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
 /**
- * The class represents values for options as a list of strings.
- * The \b sl_value argument is directly used in internal map.
+ * All the values are checked in one pass and each problem is reported
+ * as an error, so a bad configuration is noticed at startup rather than
+ * when the value is first used. Options without a value are not checked.
+ *
+ * @param validator the compiled constraints
+ * @param um communication object
+ * @return true if all the values are acceptable
+ */
+bool AppOpts::validate (const OptValidator & validator, UserMsg & um) const
+{
+    APPOPTS_TRACE_ENTRY;
+    QStringList errors = validator.compileErrors ();
+    bool b_ret = validator.validate (table_, &errors) && errors.isEmpty ();
+    foreach (const QString & s_err, errors) {
+        um.addErr (s_err);
+    }
+    APPOPTS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Each group is entered once and all the options in that group are looked
+ * up before leaving it. The values only go into the layer of the file;
+ * the caller materializes each option once all the files were read.
+ * Options found in the binary cache of the file do not touch the PerSt
+ * instance; a group is only entered (and the file only parsed, see
+ * `cfgFile()`) if one of its options is missing from the cache.
+ *
+ * @param cfg one of the CfgFile values
+ * @param list the list of variables to search
+ * @param groups indices in the list for each group
+ * @param found for the variables that were found, the file they were found in
+ * @param recs for the variables that were found, what the file knows
+ * @param um communication object
+ */
+void AppOpts::readGroupsFromCfg (
+        int cfg, const OneOptList & list,
+        const QMap<QString, QList<int> > & groups,
+        QVector<int> & found, QVector<OptBinCache::Record> & recs,
+        UserMsg & um)
+{
+    APPOPTS_TRACE_ENTRY;
+    if (!hasCfgFile (cfg)) {
+        APPOPTS_TRACE_EXIT;
+        return;
+    }
+
+    BinCacheState & st = bin_state_[cfg];
+    PerSt * perst = NULL;
+    QMap<QString, QList<int> >::const_iterator g = groups.constBegin ();
+    QMap<QString, QList<int> >::const_iterator endg = groups.constEnd ();
+    for (; g != endg; ++g) {
+        const QString & s_group = g.key ();
+        bool b_entered = false;
+
+        foreach (int i, g.value ()) {
+            const OneOpt & opt = list.at (i);
+            QString s_key = opt.fullName();
+            APPOPTS_TRACE_SPAN("readOption", s_key);
+            OptBinCache::Record rec;
+            if ((st.cache_ == NULL) || !st.cache_->lookup (s_key, &rec)) {
+                rec = OptBinCache::absentRecord ();
+                if (!b_entered) {
+                    perst = cfgFile (cfg);
+                    if ((perst != NULL) && !s_group.isEmpty()) {
+                        perst->beginGroup (s_group);
+                    }
+                    b_entered = true;
+                }
+                if (perst != NULL) {
+                    if (perst->hasKey (opt.name_)) {
+                        rec.present_ = true;
+                        rec.values_ = perst->valueSList (opt.name_);
+                    }
+                    if (!st.path_.isEmpty ()) {
+                        st.records_.insert (s_key, rec);
+                        st.dirty_ = true;
+                    }
+                }
+            }
+
+            setCfgLayer (cfg, s_key, rec);
+            if (rec.present_) {
+                um.addDbgInfo( (QString (
+                                    "Option %1 found in "
+                                    "configuration file %2.")
+                                .arg(opt.name_)
+                                .arg(cfgLocation (cfg))));
+                found[i] = cfg;
+                recs[i] = rec;
+            }
+        }
+
+        if (b_entered && (perst != NULL) && !s_group.isEmpty()) {
+            perst->endGroup (s_group);
+        }
+    }
+    APPOPTS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The class represents values for options as a list of strings. This
+ * overload will create a list with a single member and use that as a value.
+ *
+ * Any value that was previously assigned to this option will be overwritten.
+ * The value goes into the runtime layer, which takes precedence over
+ * all other layers.
+ *
+ * @param s_key the name of the variable to change
+ * @param s_value a string value to use
+ */
+void AppOpts::setValue (
+        const QString & s_key, const QString & s_value)
+{
+    QStringList sl_value (s_value);
+    if (txn_open_) {
+        stageValue (s_key, sl_value, false);
+        return;
+    }
+    layers_.setValue (OptLayers::RuntimeLayer, s_key, sl_value);
+    storeValue (s_key, sl_value);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The class represents values for options as a list of strings.
+ * The \b sl_value argument is directly used in internal map.
  *
  * Any value that was previously assigned to this option will be overwritten.
  *
@@ -425,7 +1040,15 @@ void AppOpts::setValue (
 void AppOpts::setValue (
         const QString & s_key, const QStringList & sl_value)
 {
-    insert (s_key, sl_value);
+    if (txn_open_) {
+        stageValue (s_key, sl_value, false);
+        return;
+    }
+    layers_.setValue (OptLayers::RuntimeLayer, s_key, sl_value);
+    storeValue (s_key, sl_value);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
+    }
 }
 /* ========================================================================= */
 
@@ -434,7 +1057,7 @@ void AppOpts::setValue (
  * The class represents values for options as a list of strings. This
  * overload will either create a list with a single member and use that as
  * a value if the option is not found or append \b s_value to internal list
- * associated with this option.
+ * associated with this option. The result goes into the runtime layer.
  *
  * @param s_key the name of the variable to change
  * @param s_value a string value to use
@@ -442,12 +1065,18 @@ void AppOpts::setValue (
 void AppOpts::appendValue (
         const QString & s_key, const QString & s_value)
 {
-    QMap<QString,QStringList>::iterator found = find (s_key);
-    QMap<QString,QStringList>::iterator endi = end();
-    if (found == endi) {
-        insert (s_key, QStringList(s_value));
-    } else {
-        found.value().append (s_value);
+    if (txn_open_) {
+        stageValue (s_key, QStringList(s_value), true);
+        return;
+    }
+    loadLazily (s_key);
+    storeAppend (s_key, QStringList(s_value));
+    const QStringList * merged = table_.values (table_.find (s_key));
+    layers_.setValue (
+                OptLayers::RuntimeLayer, s_key,
+                merged == NULL ? QStringList () : *merged);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
     }
 }
 /* ========================================================================= */
@@ -456,6 +1085,7 @@ void AppOpts::appendValue (
 /**
  * The class represents values for options as a list of strings. If the option
  * is already present inside t6he two lists will be merged.
+ * The result goes into the runtime layer.
  *
  * @param s_key the name of the variable to change
  * @param s_value a string value to use
@@ -463,15 +1093,76 @@ void AppOpts::appendValue (
 void AppOpts::appendValues (
         const QString & s_key, const QStringList & sl_values)
 {
-    QMap<QString,QStringList>::iterator found = find (s_key);
-    QMap<QString,QStringList>::iterator endi = end();
-    if (found == endi) {
-        insert (s_key, sl_values);
-    } else {
-        found.value().append (sl_values);
+    if (txn_open_) {
+        stageValue (s_key, sl_values, true);
+        return;
+    }
+    loadLazily (s_key);
+    storeAppend (s_key, sl_values);
+    const QStringList * merged = table_.values (table_.find (s_key));
+    layers_.setValue (
+                OptLayers::RuntimeLayer, s_key,
+                merged == NULL ? QStringList () : *merged);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
+    }
+}
+/* ========================================================================= */
+
+#ifdef Q_COMPILER_RVALUE_REFS
+/* ------------------------------------------------------------------------- */
+/**
+ * Same as the overload taking a constant reference, but the list is moved
+ * into the table instead of being shared with the caller.
+ *
+ * @param s_key the name of the variable to change
+ * @param sl_value the new value; left empty
+ */
+void AppOpts::setValue (
+        const QString & s_key, QStringList && sl_value)
+{
+    if (txn_open_) {
+        stageValue (s_key, sl_value, false);
+        sl_value.clear ();
+        return;
+    }
+    layers_.setValue (OptLayers::RuntimeLayer, s_key, sl_value);
+    storeValue (s_key, std::move (sl_value), OptTable::hashKey (s_key));
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same as the overload taking a constant reference, but if the option
+ * has no value the list is moved into the table.
+ *
+ * @param s_key the name of the variable to change
+ * @param sl_values the values to append; left empty
+ */
+void AppOpts::appendValues (
+        const QString & s_key, QStringList && sl_values)
+{
+    if (txn_open_) {
+        stageValue (s_key, sl_values, true);
+        sl_values.clear ();
+        return;
+    }
+    loadLazily (s_key);
+    storeAppend (s_key, std::move (sl_values));
+    sl_values.clear ();
+    const QStringList * merged = table_.values (table_.find (s_key));
+    layers_.setValue (
+                OptLayers::RuntimeLayer, s_key,
+                merged == NULL ? QStringList () : *merged);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
     }
 }
 /* ========================================================================= */
+#endif
 
 /* ------------------------------------------------------------------------- */
 /**
@@ -501,49 +1192,50 @@ bool AppOpts::setCurrentConfig (const QString & s_file_input, UserMsg & um)
 {
     bool b_ret = false;
     PerSt * new_current_ = NULL;
+    int new_cfg = -1;
     QString s_file = s_file_input;
     for (;;) {
         if (s_file == "system") {
-            if (system_file_ == NULL) {
+            if (!hasCfgFile (SystemCfg)) {
                 um.addErr (QObject::tr(
                                "System configuration file was not found; "
                                "it can't be made current."));
                 break;
             }
-            new_current_ = system_file_;
+            new_cfg = SystemCfg;
         } else if (s_file == "user") {
-            if (user_file_ == NULL) {
+            if (!hasCfgFile (UserCfg)) {
                 um.addErr (QObject::tr(
                                "User configuration file was not found; "
                                "it can't be made current."));
                 break;
             }
-            new_current_ = user_file_;
+            new_cfg = UserCfg;
         } else if (s_file == "local") {
-            if (local_file_ == NULL) {
+            if (!hasCfgFile (LocalCfg)) {
                 um.addErr (QObject::tr(
                                "Local configuration file was not found; "
                                "it can't be made current."));
                 break;
             }
-            new_current_ = local_file_;
+            new_cfg = LocalCfg;
         } else if (s_file.isEmpty ()) {
             um.addErr (QObject::tr(
                            "No configuration file was provided."));
             break;
         } else {
-            if (system_file_ != NULL) {
-                if (s_file == system_file_->location()) {
+            if (hasCfgFile (SystemCfg)) {
+                if (s_file == cfgLocation (SystemCfg)) {
                     s_file = "system";
                     continue;
                 }
-            } else if (user_file_ != NULL) {
-                if (s_file == user_file_->location()) {
+            } else if (hasCfgFile (UserCfg)) {
+                if (s_file == cfgLocation (UserCfg)) {
                     s_file = "user";
                     continue;
                 }
-            } else if (local_file_ != NULL) {
-                if (s_file == local_file_->location()) {
+            } else if (hasCfgFile (LocalCfg)) {
+                if (s_file == cfgLocation (LocalCfg)) {
                     s_file = "local";
                     continue;
                 }
@@ -563,48 +1255,152 @@ bool AppOpts::setCurrentConfig (const QString & s_file_input, UserMsg & um)
         break;
     }
     if (b_ret) {
-        if (current_file_ != NULL) {
-            if ((current_file_ != system_file_) &&
-                    (current_file_ != user_file_) &&
-                    (current_file_ != local_file_)) {
-                delete current_file_;
-                current_file_ = NULL;
-            }
-        }
+        delete current_file_;
         current_file_ = new_current_;
+        current_cfg_ = new_cfg;
     }
     return b_ret;
 }
 /* ========================================================================= */
 
+/* ------------------------------------------------------------------------- */
+/**
+ * The handle stays valid for the lifetime of this instance, across
+ * `setValue()`, `appendValue()`, `appendValues()`, `removeValue()` and reloads,
+ * so it can be resolved once at startup and then used in hot paths.
+ * The option does not need to have a value when the handle is created.
+ *
+ * @param s_name full name of the option
+ * @return the handle
+ */
+OptHandle AppOpts::handle (const QString & s_name)
+{
+    int i_slot = table_.slot (s_name);
+    if (lazy_load_ && (table_.values (i_slot) == NULL)) {
+        lazyValue (s_name);
+    }
+    return OptHandle (i_slot);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param opt definition of the option; its full name is used
+ * @return the handle
+ */
+OptHandle AppOpts::handle (const OneOpt & opt)
+{
+    int i_slot = table_.slot (opt.fullName (), opt.fullHash ());
+    if (lazy_load_ && (table_.values (i_slot) == NULL)) {
+        lazyValue (opt.fullName ());
+    }
+    return OptHandle (i_slot);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueB(OptHandle, bool)` for details.
+ *
+ * @param s_name name of the option to retrieve
+ * @param b_default default value if the option is not found
+ * @return the result
+ */
+bool AppOpts::valueB (
+        const QString & s_name, bool b_default) const
+{
+    return valueB (OptHandle (slotForRead (s_name)), b_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueI(OptHandle, int)` for details.
+ *
+ * @param s_name name of the option to retrieve
+ * @param i_default default value if the option is not found or
+ *        can't be converted
+ * @return the integer
+ */
+int AppOpts::valueI (
+        const QString & s_name, int i_default) const
+{
+    return valueI (OptHandle (slotForRead (s_name)), i_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueD(OptHandle, double)` for details.
+ *
+ * @param s_name name of the option to retrieve
+ * @param d_default default value if the option is not found or
+ *        can't be converted
+ * @return the number
+ */
+double AppOpts::valueD (
+        const QString & s_name, double d_default) const
+{
+    return valueD (OptHandle (slotForRead (s_name)), d_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueS(OptHandle, const QString &)` for details.
+ *
+ * @param s_name name of the option to retrieve
+ * @param s_default default value if the option is not found
+ * @return the string that was found
+ */
+QString AppOpts::valueS (
+        const QString & s_name, const QString & s_default) const
+{
+    return valueS (OptHandle (slotForRead (s_name)), s_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueSL(OptHandle, const QStringList &)` for details.
+ *
+ * @param s_name name of the option to retrieve
+ * @param sl_default default value if the option is not found
+ * @return the list that was found
+ */
+QStringList AppOpts::valueSL (
+        const QString & s_name, const QStringList & sl_default) const
+{
+    return valueSL (OptHandle (slotForRead (s_name)), sl_default);
+}
+/* ========================================================================= */
+
 /* ------------------------------------------------------------------------- */
 /**
  * The class represents values for options as a list of strings. For boolean
  * values first entry in the list is used and the string is compared against
  * `FALSE`, `false` and `0`; if the string matches the value is false,
- * otherwise it is true.
+ * otherwise it is true. The result of the comparison is cached until
+ * the value changes.
  *
- * @param s_name name of the option to retrieve
+ * @param h handle of the option to retrieve (see `handle()`)
  * @param b_default default value if the option is not found
  * @return the result
  */
 bool AppOpts::valueB (
-        const QString & s_name, bool b_default) const
+        OptHandle h, bool b_default) const
 {
-    QMap<QString,QStringList>::const_iterator found = find (s_name);
-    QMap<QString,QStringList>::const_iterator endi = end();
-    if (found == endi) {
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    bool result = false;
+    if (!table_.toBool (h.slot (), &result)) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), false);
+        }
         return b_default;
     } else {
-        QStringList sl_result = *found;
-        if (sl_result.count () == 0) {
-            return b_default;
-        } else {
-            return !(
-                    (sl_result.at (0) == "FALSE") ||
-                    (sl_result.at (0) == "false") ||
-                    (sl_result.at (0) == "0"));
-        }
+        return result;
     }
 }
 /* ========================================================================= */
@@ -613,33 +1409,30 @@ bool AppOpts::valueB (
 /**
  * The class represents values for options as a list of strings. For integer
  * values first entry in the list is used and converted into integer.
- * If the conversion fails the default value is returned.
+ * If the conversion fails (including values that do not fit into an `int`)
+ * the default value is returned. The conversion is cached until
+ * the value changes.
  *
- * @param s_name name of the option to retrieve
+ * @param h handle of the option to retrieve (see `handle()`)
  * @param i_default default value if the option is not found or
  *        can't be converted
  * @return the integer
  */
 int AppOpts::valueI (
-        const QString & s_name, int i_default) const
+        OptHandle h, int i_default) const
 {
-    QMap<QString,QStringList>::const_iterator found = find (s_name);
-    QMap<QString,QStringList>::const_iterator endi = end();
-    if (found == endi) {
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    qint64 result = 0;
+    if (!table_.toInt (h.slot (), &result) ||
+            (result < INT_MIN) || (result > INT_MAX)) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), true);
+        }
         return i_default;
     } else {
-        QStringList sl_result = *found;
-        if (sl_result.count () == 0) {
-            return i_default;
-        } else {
-            bool b_ok = false;
-            int result = sl_result.at (0).toInt (&b_ok);
-            if (!b_ok) {
-                return i_default;
-            } else {
-                return result;
-            }
-        }
+        return static_cast<int>(result);
     }
 }
 /* ========================================================================= */
@@ -648,33 +1441,28 @@ int AppOpts::valueI (
 /**
  * The class represents values for options as a list of strings. For double
  * values first entry in the list is used and converted into double.
- * If the conversion fails the default value is returned.
+ * If the conversion fails the default value is returned. The conversion
+ * is cached until the value changes.
  *
- * @param s_name name of the option to retrieve
+ * @param h handle of the option to retrieve (see `handle()`)
  * @param d_default default value if the option is not found or
  *        can't be converted
  * @return the number
  */
 double AppOpts::valueD (
-        const QString & s_name, double d_default) const
+        OptHandle h, double d_default) const
 {
-    QMap<QString,QStringList>::const_iterator found = find (s_name);
-    QMap<QString,QStringList>::const_iterator endi = end();
-    if (found == endi) {
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    double result = 0.0;
+    if (!table_.toDouble (h.slot (), &result)) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), true);
+        }
         return d_default;
     } else {
-        QStringList sl_result = *found;
-        if (sl_result.count () == 0) {
-            return d_default;
-        } else {
-            bool b_ok = false;
-            double result = sl_result.at (0).toDouble (&b_ok);
-            if (!b_ok) {
-                return d_default;
-            } else {
-                return result;
-            }
-        }
+        return result;
     }
 }
 /* ========================================================================= */
@@ -684,24 +1472,24 @@ double AppOpts::valueD (
  * The class represents values for options as a list of strings. For string
  * values first entry in the list is used.
  *
- * @param s_name name of the option to retrieve
+ * @param h handle of the option to retrieve (see `handle()`)
  * @param s_default default value if the option is not found
  * @return the string that was found
  */
 QString AppOpts::valueS (
-        const QString & s_name, const QString & s_default) const
+        OptHandle h, const QString & s_default) const
 {
-    QMap<QString,QStringList>::const_iterator found = find (s_name);
-    QMap<QString,QStringList>::const_iterator endi = end();
-    if (found == endi) {
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    const QStringList * found = table_.values (h.slot ());
+    if ((found == NULL) || found->isEmpty ()) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), false);
+        }
         return s_default;
     } else {
-        QStringList sl_result = *found;
-        if (sl_result.count () == 0) {
-            return s_default;
-        } else {
-            return sl_result.at (0);
-        }
+        return found->at (0);
     }
 }
 /* ========================================================================= */
@@ -713,25 +1501,1417 @@ QString AppOpts::valueS (
  *
  * An empty list is interpreted as a missing value and default list is returned.
  *
- * @param s_name name of the option to retrieve
+ * @param h handle of the option to retrieve (see `handle()`)
  * @param s_default default value if the option is not found
  * @return the list that was found
  */
 QStringList AppOpts::valueSL (
-        const QString & s_name, const QStringList & sl_default) const
+        OptHandle h, const QStringList & sl_default) const
 {
-    QMap<QString,QStringList>::const_iterator found = find (s_name);
-    QMap<QString,QStringList>::const_iterator endi = end();
-    if (found == endi) {
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    const QStringList * found = table_.values (h.slot ());
+    if ((found == NULL) || found->isEmpty ()) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), false);
+        }
         return sl_default;
     } else {
-        QStringList sl_result = *found;
-        if (sl_result.count () == 0) {
-            return sl_default;
-        } else {
-            return sl_result;
+        return *found;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Unlike `valueS()` this method does not copy anything, so it does not
+ * touch the reference count of the shared string.
+ *
+ * The reference points into the storage of this instance. It stays valid
+ * until the next change to this instance (`setValue()`, `appendValue()`,
+ * `appendValues()`, `removeValue()`, loading files or reading values from
+ * them). Copy the string if it needs to outlive such a change.
+ *
+ * @param h handle of the option to retrieve (see `handle()`)
+ * @return the first value or an empty string if the option has no value
+ */
+const QString & AppOpts::valueSRef (OptHandle h) const
+{
+    static const QString s_empty;
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    const QStringList * found = table_.values (h.slot ());
+    if ((found == NULL) || found->isEmpty ()) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), false);
+        }
+        return s_empty;
+    } else {
+        return found->at (0);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueSRef(OptHandle)` for the lifetime of the result.
+ *
+ * @param s_name name of the option to retrieve
+ * @return the first value or an empty string if the option has no value
+ */
+const QString & AppOpts::valueSRef (const QString & s_name) const
+{
+    return valueSRef (OptHandle (slotForRead (s_name)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Unlike `valueSL()` this method does not copy the list. An option that
+ * is not found results in a reference to an empty list.
+ *
+ * See `valueSRef(OptHandle)` for the lifetime of the result.
+ *
+ * @param h handle of the option to retrieve (see `handle()`)
+ * @return the list of values (may be empty)
+ */
+const QStringList & AppOpts::valueSLRef (OptHandle h) const
+{
+    static const QStringList sl_empty;
+    if (metrics_ != NULL) {
+        metrics_->add (h.slot (), OptMetrics::Reads);
+    }
+    const QStringList * found = table_.values (h.slot ());
+    if (found == NULL) {
+        if (metrics_ != NULL) {
+            countDefault (h.slot (), false);
+        }
+        return sl_empty;
+    } else {
+        return *found;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `valueSRef(OptHandle)` for the lifetime of the result.
+ *
+ * @param s_name name of the option to retrieve
+ * @return the list of values (may be empty)
+ */
+const QStringList & AppOpts::valueSLRef (const QString & s_name) const
+{
+    return valueSLRef (OptHandle (slotForRead (s_name)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The values are only kept in the table, so there is nothing to rebuild
+ * it from; the method is kept for code written against the `QMap` base.
+ */
+void AppOpts::reindex ()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key the name of the variable to change
+ * @param sl_value the new value
+ * @param hash the hash of the key as computed by `OptTable::hashKey()`
+ */
+void AppOpts::storeValue (
+        const QString & s_key, const QStringList & sl_value, uint hash)
+{
+    int i_slot = table_.slot (s_key, hash);
+    recordChange (s_key, i_slot);
+    table_.setValues (i_slot, sl_value);
+    valuesChanged ();
+}
+/* ========================================================================= */
+
+#ifdef Q_COMPILER_RVALUE_REFS
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key the name of the variable to change
+ * @param sl_value the new value; left empty
+ * @param hash the hash of the key as computed by `OptTable::hashKey()`
+ */
+void AppOpts::storeValue (
+        const QString & s_key, QStringList && sl_value, uint hash)
+{
+    int i_slot = table_.slot (s_key, hash);
+    recordChange (s_key, i_slot);
+    table_.setValues (i_slot, std::move (sl_value));
+    valuesChanged ();
+}
+/* ========================================================================= */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key the name of the variable to change
+ * @param sl_value the values to append
+ */
+void AppOpts::storeAppend (
+        const QString & s_key, const QStringList & sl_value)
+{
+    int i_slot = table_.slot (s_key);
+    recordChange (s_key, i_slot);
+    table_.appendValues (i_slot, sl_value);
+    valuesChanged ();
+}
+/* ========================================================================= */
+
+#ifdef Q_COMPILER_RVALUE_REFS
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key the name of the variable to change
+ * @param sl_value the values to append; moved into the table if the
+ *        option has no value
+ */
+void AppOpts::storeAppend (
+        const QString & s_key, QStringList && sl_value)
+{
+    int i_slot = table_.slot (s_key);
+    recordChange (s_key, i_slot);
+    table_.appendValues (i_slot, std::move (sl_value));
+    valuesChanged ();
+}
+/* ========================================================================= */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/**
+ * In snapshot mode a new table is published after every change, so that
+ * readers using `snapshot()` always see current values. Changes made by
+ * `loadFromAll()` and `readMultipleFromCfgs()` are published once, at the
+ * end. Enabling the mode publishes current values immediately.
+ *
+ * Each publish copies the whole table: the entries are implicitly shared
+ * with the published copy, so the next change to this instance detaches
+ * them, which costs time and memory proportional to the number of options.
+ * A single `setValue()` in this mode is thus O(n). Code that changes
+ * several options should group the changes between `beginTransaction()`
+ * and `commitTransaction()`, which publishes once for the whole group.
+ *
+ * @param b_enable true to enable the mode
+ */
+void AppOpts::setSnapshotMode (bool b_enable)
+{
+    snapshot_mode_ = b_enable;
+    if (b_enable) {
+        publish ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A copy of current values is made and handed to `snapshot()`. Readers
+ * that were already reading continue to use the previous table; the
+ * method returns once they are done with it.
+ *
+ * Handles obtained from this instance can be used with the readers.
+ */
+void AppOpts::publish ()
+{
+    snapshot_.publish (new OptTable (table_));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Inside a batch the effects are deferred until the batch ends, except
+ * for the group index, which is kept up to date so that the group methods
+ * see the new options right away. Subscribers are informed after the
+ * snapshot was published.
+ */
+void AppOpts::valuesChanged ()
+{
+    updateTrie ();
+    if (batch_depth_ > 0) {
+        batch_changed_ = true;
+        return;
+    }
+    if (snapshot_mode_) {
+        publish ();
+    }
+    if ((changes_ != NULL) && changes_->hasPending ()) {
+        changes_->flush (table_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Batches may be nested.
+ */
+void AppOpts::beginBatch ()
+{
+    ++batch_depth_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * When the outermost batch ends and changes were made inside it
+ * `valuesChanged()` is called once.
+ */
+void AppOpts::endBatch ()
+{
+    Q_ASSERT(batch_depth_ > 0);
+    --batch_depth_;
+    if ((batch_depth_ == 0) && batch_changed_) {
+        batch_changed_ = false;
+        valuesChanged ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * While the transaction is open `setValue()`, `appendValue()` and
+ * `appendValues()` record the new values without touching the table,
+ * the layers or the snapshot, so readers keep seeing the values from
+ * before the transaction. The getters of this instance also return the
+ * old values. Transactions do not nest.
+ *
+ * @return false if a transaction was already open
+ */
+bool AppOpts::beginTransaction ()
+{
+    if (txn_open_)
+        return false;
+    txn_open_ = true;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The staged values go into the runtime layer and the table in a single
+ * batch, so a snapshot is published once and the subscribers (see
+ * `subscribe()`) are informed once. The writer (see `setWriteBack()`)
+ * receives the options whose value changed in a single call.
+ *
+ * @return the options whose value changed, with the old and new values,
+ *         in the order in which they were first staged
+ */
+QList<OptChange> AppOpts::commitTransaction ()
+{
+    QList<OptChange> result;
+    if (!txn_open_)
+        return result;
+    txn_open_ = false;
+
+    QStringList keys;
+    keys.swap (txn_order_);
+    QHash<QString,QStringList> values;
+    values.swap (txn_values_);
+    APPOPTS_TRACE_SPAN("commit", QString::number (keys.count ()));
+
+    result.reserve (keys.count ());
+    QStringList sl_dirty;
+    beginBatch ();
+    foreach (const QString & s_key, keys) {
+        uint hash = OptTable::hashKey (s_key);
+        const QStringList & sl_new = values.constFind (s_key).value ();
+        const QStringList * old = table_.values (table_.find (s_key, hash));
+        if ((old == NULL) || (*old != sl_new)) {
+            OptChange change;
+            change.key_ = s_key;
+            change.had_old_ = (old != NULL);
+            if (old != NULL) {
+                change.old_ = *old;
+            }
+            change.new_ = sl_new;
+            change.has_new_ = true;
+            result.append (change);
+            sl_dirty.append (s_key);
+        }
+        layers_.setValue (OptLayers::RuntimeLayer, s_key, sl_new);
+        storeValue (s_key, sl_new, hash);
+    }
+    endBatch ();
+
+    if ((saver_ != NULL) && !sl_dirty.isEmpty ()) {
+        saver_->markDirty (sl_dirty);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Nothing was applied, so nothing needs to be undone.
+ */
+void AppOpts::rollbackTransaction ()
+{
+    txn_open_ = false;
+    txn_order_.clear ();
+    txn_values_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Appending to an option that was not staged yet starts from its
+ * current value; in lazy mode that value is read from the files first.
+ *
+ * @param s_key the name of the variable to change
+ * @param sl_value the new value or the values to append
+ * @param b_append append to the value instead of replacing it
+ */
+void AppOpts::stageValue (
+        const QString & s_key, const QStringList & sl_value, bool b_append)
+{
+    QHash<QString,QStringList>::iterator staged = txn_values_.find (s_key);
+    if (staged == txn_values_.end ()) {
+        loadLazily (s_key);
+        txn_order_.append (s_key);
+        if (b_append) {
+            const QStringList * current = table_.values (table_.find (s_key));
+            QStringList sl_result;
+            if (current != NULL) {
+                sl_result = *current;
+            }
+            sl_result.append (sl_value);
+            txn_values_.insert (s_key, sl_result);
+        } else {
+            txn_values_.insert (s_key, sl_value);
+        }
+    } else if (b_append) {
+        staged.value ().append (sl_value);
+    } else {
+        staged.value () = sl_value;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The listener receives one call per change made outside a batch and
+ * one call per batch (for example, a `loadFromAll()` or a reload),
+ * with the old and new values of the options that ended up with a
+ * different value. Changes staged in a transaction are reported as one
+ * batch by `commitTransaction()`.
+ *
+ * @param s_key full name of the option
+ * @param listener the object to inform; must be unsubscribed before
+ *        it goes away
+ * @param delivery immediately or from the event loop (see OptChanges)
+ */
+void AppOpts::subscribe (
+        const QString & s_key, OptChangeListener * listener,
+        OptChanges::Delivery delivery)
+{
+    if (changes_ == NULL) {
+        changes_ = new OptChanges ();
+    }
+    changes_->subscribe (s_key, listener, delivery);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same as `subscribe()` for all the options in a group and in the groups
+ * nested inside it.
+ *
+ * @param s_group the group; empty for all options
+ * @param listener the object to inform; must be unsubscribed before
+ *        it goes away
+ * @param delivery immediately or from the event loop (see OptChanges)
+ */
+void AppOpts::subscribeGroup (
+        const QString & s_group, OptChangeListener * listener,
+        OptChanges::Delivery delivery)
+{
+    if (changes_ == NULL) {
+        changes_ = new OptChanges ();
+    }
+    changes_->subscribeGroup (s_group, listener, delivery);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param listener the object added with `subscribe()` or `subscribeGroup()`
+ */
+void AppOpts::unsubscribe (OptChangeListener * listener)
+{
+    if (changes_ != NULL) {
+        changes_->unsubscribe (listener);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Useful for listeners with queued delivery in a thread without
+ * an event loop.
+ */
+void AppOpts::deliverChanges ()
+{
+    if (changes_ != NULL) {
+        changes_->deliverQueued ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * When enabled, the system, user and local files are watched. A file that
+ * changes is parsed again in a worker thread and the options that were read
+ * through `readValueFromCfgs()` or `readMultipleFromCfgs()` are merged again.
+ * Options whose value changed are updated in one batch in the thread of
+ * this instance, which needs a running event loop; the listeners
+ * are then informed.
+ *
+ * Files loaded by `loadFromAll()` after this call are also watched.
+ *
+ * @param b_enable true to start watching, false to stop
+ */
+void AppOpts::setHotReload (bool b_enable)
+{
+    if (b_enable) {
+        if (watcher_ == NULL) {
+            watcher_ = new OptWatcher (this);
+        }
+        watchCfgFiles ();
+    } else if (watcher_ != NULL) {
+        delete watcher_;
+        watcher_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Once enabled, the options changed by `setValue()`, `appendValue()` and
+ * `appendValues()` are written to the current file (see
+ * `setCurrentConfig()`) when no other change arrived for \b i_delay_ms
+ * milliseconds. The delay relies on the event loop of the thread of this
+ * instance; `saveChanges()` writes the pending changes right away.
+ * Disabling the write-back writes the pending changes first.
+ *
+ * Only the values set by the application are written; see OptSaver for
+ * the way the file is rewritten. With hot reload (see `setHotReload()`)
+ * the file is not reloaded because of these writes.
+ *
+ * @param b_enable true to write changes back
+ * @param i_delay_ms time to wait for more changes before writing
+ * @param b_async true to write in a worker thread
+ */
+void AppOpts::setWriteBack (bool b_enable, int i_delay_ms, bool b_async)
+{
+    if (b_enable) {
+        if (saver_ == NULL) {
+            saver_ = new OptSaver (this);
+        }
+        saver_->setDelay (i_delay_ms);
+        saver_->setAsync (b_async);
+    } else if (saver_ != NULL) {
+        delete saver_;
+        saver_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Once enabled, the getters of this instance count, for each option,
+ * the reads, the reads that found no value (misses), the reads that
+ * returned the default value and, for `valueI()` and `valueD()`, the values
+ * that could not be converted. Names that are looked up but are not known
+ * are counted together. Reads through snapshots (see `snapshot()`) are not
+ * counted.
+ *
+ * When disabled the getters only test a pointer. Enabling or disabling
+ * must not overlap with reads in other threads; disabling drops
+ * the counters.
+ *
+ * @param b_enable true to count reads
+ */
+void AppOpts::setMetrics (bool b_enable)
+{
+    if (b_enable) {
+        if (metrics_ == NULL) {
+            metrics_ = new OptMetrics ();
+        }
+    } else if (metrics_ != NULL) {
+        delete metrics_;
+        metrics_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Does nothing if metrics are disabled.
+ */
+void AppOpts::resetMetrics ()
+{
+    if (metrics_ != NULL) {
+        metrics_->reset ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `OptMetrics::toJson()` for the format.
+ *
+ * @return the counters or nothing if metrics are disabled
+ */
+QByteArray AppOpts::metricsJson () const
+{
+    if (metrics_ == NULL) {
+        return QByteArray ();
+    }
+    return metrics_->toJson (table_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only called when metrics are enabled, on the slow path of the getters.
+ * The option either had no value or, for typed getters, its first value
+ * could not be converted.
+ *
+ * @param i_slot the slot that was read (may be -1)
+ * @param b_converted true for getters that convert the value
+ */
+void AppOpts::countDefault (int i_slot, bool b_converted) const
+{
+    metrics_->add (i_slot, OptMetrics::Defaults);
+    const QStringList * found = table_.values (i_slot);
+    if ((found == NULL) || found->isEmpty ()) {
+        metrics_->add (i_slot, OptMetrics::Misses);
+    } else if (b_converted) {
+        metrics_->add (i_slot, OptMetrics::ParseFailures);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Waits for the writes that are in progress, then writes the pending
+ * changes in the calling thread.
+ *
+ * @param um communication object
+ * @return false if write-back is disabled or a write failed
+ */
+bool AppOpts::saveChanges (UserMsg & um)
+{
+    if (saver_ == NULL) {
+        um.addErr (QObject::tr("Changes are not tracked; "
+                               "enable write-back first."));
+        return false;
+    }
+    QString s_error;
+    bool b_ret = saver_->flush (&s_error);
+    if (!b_ret) {
+        um.addErr (QObject::tr("Changes could not be saved: %1")
+                   .arg (s_error));
+    }
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The listener is called in the thread of this instance. The caller
+ * retains the ownership of the listener.
+ *
+ * @param listener the object to add
+ */
+void AppOpts::addReloadListener (OptReloadListener * listener)
+{
+    if (!reload_listeners_.contains (listener)) {
+        reload_listeners_.append (listener);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param listener the object to remove
+ */
+void AppOpts::removeReloadListener (OptReloadListener * listener)
+{
+    reload_listeners_.removeAll (listener);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param cfg one of the CfgFile values
+ * @return the member that holds the file
+ */
+PerSt ** AppOpts::cfgSlot (int cfg)
+{
+    switch (cfg) {
+    case SystemCfg: return &system_file_;
+    case UserCfg: return &user_file_;
+    default: return &local_file_;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param cfg one of the CfgFile values
+ * @return the member that holds the file
+ */
+PerSt * const * AppOpts::cfgSlot (int cfg) const
+{
+    switch (cfg) {
+    case SystemCfg: return &system_file_;
+    case UserCfg: return &user_file_;
+    default: return &local_file_;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A file that was loaded from a fresh binary cache has no PerSt instance
+ * until an option that the cache does not know about is looked up; the
+ * file is parsed then and kept for later lookups.
+ *
+ * @param cfg one of the CfgFile values
+ * @return the parsed file or NULL if there is no file or it can't be parsed
+ */
+PerSt * AppOpts::cfgFile (int cfg)
+{
+    PerSt ** slot = cfgSlot (cfg);
+    BinCacheState & st = bin_state_[cfg];
+    if ((*slot == NULL) && (st.cache_ != NULL)) {
+        QString s_version;
+        QString s_error;
+        *slot = parseCfgFile (st.path_, &s_version, &s_error);
+    }
+    return *slot;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param cfg one of the CfgFile values
+ * @return true if the file was loaded, parsed or from its binary cache
+ */
+bool AppOpts::hasCfgFile (int cfg) const
+{
+    return (*cfgSlot (cfg) != NULL) ||
+            (bin_state_[cfg].cache_ != NULL);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param cfg one of the CfgFile values
+ * @return the path of the file or an empty string
+ */
+QString AppOpts::cfgLocation (int cfg) const
+{
+    PerSt * perst = *cfgSlot (cfg);
+    if (perst != NULL) {
+        return perst->location ();
+    }
+    return bin_state_[cfg].path_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the path of the file where changes are saved or an empty string
+ */
+QString AppOpts::currentLocation () const
+{
+    if (current_cfg_ != -1) {
+        return cfgLocation (current_cfg_);
+    } else if (current_file_ != NULL) {
+        return current_file_->location ();
+    }
+    return QString ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Registers the system, user and local files with the watcher.
+ */
+void AppOpts::watchCfgFiles ()
+{
+    for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+        if (hasCfgFile (cfg)) {
+            watcher_->watch (cfgLocation (cfg), cfg);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The new PerSt instance replaces the old one (which is deleted) and the
+ * layer of the file is replaced. The options that the layer affects are
+ * then merged again from the current layers, in one batch, so a value
+ * set or overridden while the file was parsed keeps its precedence;
+ * the listeners are informed about the options whose value changed.
+ * A reloaded file no longer uses a binary cache until it is loaded again
+ * by `loadFromAll()`.
+ *
+ * @param result the outcome of parsing the file in the worker thread
+ */
+void AppOpts::applyReload (const OptWatcher::Result & result)
+{
+    if (result.perst_ == NULL) {
+        foreach (OptReloadListener * listener, reload_listeners_) {
+            listener->reloadFailed (result.file_, result.error_);
+        }
+        return;
+    }
+
+    if ((result.cfg_ < 0) || (result.cfg_ >= CfgFileCount)) {
+        delete result.perst_;
+        return;
+    }
+    PerSt ** slot = cfgSlot (result.cfg_);
+    delete *slot;
+    *slot = result.perst_;
+    QSet<QString> affected = layers_.replaceLayer (
+                cfgLayer (result.cfg_), result.values_);
+    resetBinCache (result.cfg_);
+    lazy_absent_.clear ();
+
+    QStringList sl_changed;
+    beginBatch ();
+    if (!result.version_.isEmpty ()) {
+        storeValue (CFG_PERST_VERSION, QStringList (result.version_));
+    }
+    foreach (const QString & s_key, affected) {
+        uint hash = OptTable::hashKey (s_key);
+        const QStringList * before = table_.values (table_.find (s_key, hash));
+        bool b_before = (before != NULL);
+        QStringList sl_before;
+        if (b_before) {
+            sl_before = *before;
+        }
+        materialize (s_key, hash);
+        const QStringList * after = table_.values (table_.find (s_key, hash));
+        if ((b_before != (after != NULL)) ||
+                (b_before && (sl_before != *after))) {
+            sl_changed.append (s_key);
+        }
+    }
+    endBatch ();
+
+    foreach (OptReloadListener * listener, reload_listeners_) {
+        listener->optionsReloaded (result.file_, sl_changed);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Unlike the getters this method walks the layers, most specific first,
+ * and stops at the first layer that has the option.
+ *
+ * @param s_name full name of the option
+ * @param sl_out receives the value, if found
+ * @param layer receives the OptLayers::Layer that provided the value
+ *        (may be NULL)
+ * @return true if the option has a value in any layer
+ */
+bool AppOpts::layeredValue (
+        const QString & s_name, QStringList & sl_out, int * layer) const
+{
+    return layers_.resolve (s_name, &sl_out, layer);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name full name of the option
+ * @return the OptLayers::Layer that provides the value or OptLayers::NoLayer
+ */
+int AppOpts::valueOrigin (const QString & s_name) const
+{
+    return layers_.origin (s_name);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only the options present in the old or in the new content of the layer
+ * are updated; other layers are not touched. The changes are applied
+ * as a single batch.
+ *
+ * @param layer one of the OptLayers::Layer values
+ * @param values new content of the layer
+ */
+void AppOpts::replaceLayer (
+        int layer, const QHash<QString,QStringList> & values)
+{
+    QSet<QString> affected = layers_.replaceLayer (layer, values);
+    beginBatch ();
+    foreach (const QString & s_key, affected) {
+        materialize (s_key);
+    }
+    endBatch ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Options that only had a value in this layer lose their value; the others
+ * fall back to the next layer that has them.
+ *
+ * @param layer one of the OptLayers::Layer values
+ */
+void AppOpts::dropLayer (int layer)
+{
+    replaceLayer (layer, QHash<QString,QStringList>());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Arguments of the form `--group/name=value` and environment variables
+ * named `APPNAME_GROUP_NAME` (see OptOverrides) provide values for the
+ * options in \b schema; arguments win over the environment. The values
+ * replace the command line layer in a single batch, so they take
+ * precedence over all the files but not over `setValue()`.
+ *
+ * Arguments that look like options but are not in the schema usually
+ * belong to the application or to Qt, so they are only reported as debug
+ * information and the known ones are still applied. With \b b_strict
+ * they are reported as errors and the result is false. Applications that
+ * need these arguments, or the positional ones, use an OptOverrides
+ * directly (see `OptOverrides::unknown()` and `OptOverrides::positional()`)
+ * and hand it to `applyOverrides()`.
+ *
+ * @param schema the options that may be overridden
+ * @param args the arguments, starting with the program
+ *        (see `QCoreApplication::arguments()`)
+ * @param um communication object
+ * @param s_app_name name used for environment variables; the name of
+ *        the application if empty
+ * @param b_strict arguments that are not in the schema are errors
+ * @return false if \b b_strict is set and some arguments are not known
+ *         options
+ */
+bool AppOpts::loadOverrides (
+        const OneOptList & schema, const QStringList & args,
+        UserMsg & um, const QString & s_app_name, bool b_strict)
+{
+    APPOPTS_TRACE_ENTRY;
+    OptOverrides overrides (schema, s_app_name);
+    bool b_ret = overrides.parseArguments (args) || !b_strict;
+    overrides.parseEnvironment (
+                QProcessEnvironment::systemEnvironment ().toStringList ());
+    foreach (const QString & s_arg, overrides.unknown ()) {
+        if (b_strict) {
+            um.addErr (QString ("Unknown option %1.").arg (s_arg));
+        } else {
+            um.addDbgInfo (QString ("Argument %1 is not an option; "
+                                    "ignored.").arg (s_arg));
+        }
+    }
+    applyOverrides (overrides);
+    um.addDbgInfo (QString ("%1 options overridden from the command line "
+                            "and environment.")
+                   .arg (overrides.values ().count ()));
+    APPOPTS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The previous content of the command line layer is replaced.
+ *
+ * @param overrides parsed arguments and environment
+ */
+void AppOpts::applyOverrides (const OptOverrides & overrides)
+{
+    replaceLayer (OptLayers::CommandLineLayer, overrides.values ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The value that results from the layers is stored for the getters;
+ * if no layer has the key the option loses its value.
+ *
+ * @param s_key full name of the option
+ * @param hash the hash of the key as computed by `OptTable::hashKey()`
+ */
+void AppOpts::materialize (const QString & s_key, uint hash)
+{
+    QStringList sl;
+    if (layers_.resolve (s_key, &sl)) {
+        storeValue (s_key, sl, hash);
+    } else {
+        eraseValue (s_key, hash);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The slot of the option is preserved, so handles remain valid.
+ *
+ * @param s_key full name of the option
+ * @param hash the hash of the key as computed by `OptTable::hashKey()`
+ */
+void AppOpts::eraseValue (const QString & s_key, uint hash)
+{
+    int i_slot = table_.find (s_key, hash);
+    if (i_slot == -1) {
+        return;
+    }
+    if (table_.values (i_slot) != NULL) {
+        recordChange (s_key, i_slot);
+        table_.remove (i_slot);
+        valuesChanged ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * By default the files are always parsed. When enabled `loadFromAll()`
+ * uses a fresh binary cache (see OptBinCache) instead of parsing the
+ * file; the file is only parsed if an option missing from the cache is
+ * looked up. `readMultipleFromCfgs()` then writes the caches of the
+ * files that had options missing from their cache. `loadFile()` always
+ * parses the file, since it hands the PerSt instance to the caller.
+ *
+ * @param b_enable true to use binary caches
+ */
+void AppOpts::setBinaryCache (bool b_enable)
+{
+    bin_cache_ = b_enable;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * By default the getters only see the options that were read with
+ * `readValueFromCfgs()` or `readMultipleFromCfgs()`, or set by the
+ * application. When enabled, a getter that finds no value asks the
+ * local, user and system files, in this order, and keeps the first
+ * value found; the files that are less specific are not consulted.
+ * The value is stored for the getters and the group methods, so the
+ * next read costs the same as for any other option; an option that no
+ * file provides is remembered as absent until a file is loaded or
+ * reloaded. Reading does not change the values: no snapshot is
+ * published, subscribers are not informed and the sorted map (`keys()`,
+ * `contains()`, `value()`) does not list the options that were only read
+ * this way. Appending to an option reads it first, so the new values
+ * go after the ones from the file, and options read this way are
+ * refreshed when their file is reloaded.
+ * Applications with large files and few options in use thus only pay
+ * for what they read.
+ *
+ * A getter may then change this instance, so in this mode the getters
+ * must not be called concurrently; other threads should use
+ * `snapshot()`. Handles obtained with `handle()` are resolved when they
+ * are created.
+ *
+ * @param b_enable true to read missing options on demand
+ */
+void AppOpts::setLazyLoad (bool b_enable)
+{
+    lazy_load_ = b_enable;
+    lazy_absent_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The part of the name before the last `/` is the group. The value goes
+ * through the layer of the file and the binary cache, like the values
+ * read by `readValueFromCfgs()`, but is stored with `storeLazy()`, so
+ * the read does not count as a change.
+ *
+ * The getters reach this method through `slotForRead()`, the setters that
+ * build on the current value through `loadLazily()`.
+ *
+ * @param s_name full name of the option
+ * @return the slot of the option (-1 if it has none)
+ */
+int AppOpts::lazyValue (const QString & s_name)
+{
+    if (lazy_absent_.contains (s_name)) {
+        return table_.find (s_name);
+    }
+    APPOPTS_TRACE_SPAN("lazyRead", s_name);
+
+    OneOpt opt;
+    int i_sep = s_name.lastIndexOf (QChar('/'));
+    if (i_sep == -1) {
+        opt.name_ = s_name;
+    } else {
+        opt.group_ = s_name.left (i_sep);
+        opt.name_ = s_name.mid (i_sep + 1);
+    }
+    opt.refresh ();
+
+    static const int order[CfgFileCount] = { LocalCfg, UserCfg, SystemCfg };
+    for (int i = 0; i < CfgFileCount; ++i) {
+        int cfg = order[i];
+        if (!hasCfgFile (cfg))
+            continue;
+        OptBinCache::Record rec;
+        if (lookupCfgValue (cfg, opt, rec)) {
+            storeLazy (cfg, opt, rec);
+            return table_.find (s_name, opt.fullHash ());
+        }
+    }
+
+    lazy_absent_.insert (s_name);
+    return table_.find (s_name);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A cache contains the options that were looked up in the file, whether
+ * they were found or not, so that both can be answered without parsing
+ * the file. Failing to write a cache (for example, because the directory
+ * is read-only) is not an error; it is reported through the debug channel.
+ *
+ * @param um communication object
+ * @return true if all the caches that needed to be written were written
+ */
+bool AppOpts::writeBinaryCaches (UserMsg & um)
+{
+    bool b_ret = true;
+    for (int cfg = 0; cfg < CfgFileCount; ++cfg) {
+        BinCacheState & st = bin_state_[cfg];
+        if (!st.dirty_ || st.path_.isEmpty ())
+            continue;
+
+        QHash<QString,OptBinCache::Record> records;
+        if (st.cache_ != NULL) {
+            records = st.cache_->records ();
+        }
+        QHash<QString,OptBinCache::Record>::const_iterator i =
+                st.records_.constBegin ();
+        QHash<QString,OptBinCache::Record>::const_iterator endi =
+                st.records_.constEnd ();
+        for (; i != endi; ++i) {
+            records.insert (i.key (), i.value ());
+        }
+
+        QString s_error;
+        if (OptBinCache::write (st.path_, st.source_, st.version_,
+                                records, &s_error)) {
+            um.addDbgInfo (QString ("Binary cache written for %1.")
+                           .arg (st.path_));
+            st.dirty_ = false;
+        } else {
+            um.addDbgInfo (QString ("Binary cache for %1 was not written: %2")
+                           .arg (st.path_)
+                           .arg (s_error));
+            b_ret = false;
+        }
+    }
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The option is looked up in the cache of the file first; if the cache
+ * knows nothing about it the file is asked and the answer is recorded
+ * so that the next cache that is written includes it.
+ *
+ * @param cfg one of the CfgFile values
+ * @param opt definition of the variable
+ * @param rec receives what is known about the option
+ * @return true if the option is present in the file
+ */
+bool AppOpts::lookupCfgValue (
+        int cfg, const OneOpt & opt, OptBinCache::Record & rec)
+{
+    BinCacheState & st = bin_state_[cfg];
+    QString s_key = opt.fullName();
+    if ((st.cache_ != NULL) && st.cache_->lookup (s_key, &rec)) {
+        return rec.present_;
+    }
+
+    rec = OptBinCache::absentRecord ();
+    PerSt * perst = cfgFile (cfg);
+    if (perst == NULL) {
+        return false;
+    }
+    rec.present_ = valueFromPerSt (perst, opt, rec.values_);
+    if (!st.path_.isEmpty ()) {
+        st.records_.insert (s_key, rec);
+        st.dirty_ = true;
+    }
+    return rec.present_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The table is not changed; see `materializeCfgValue()`.
+ *
+ * @param cfg one of the CfgFile values
+ * @param s_key full name of the option
+ * @param rec what is known about the option
+ */
+void AppOpts::setCfgLayer (
+        int cfg, const QString & s_key, const OptBinCache::Record & rec)
+{
+    if (rec.present_) {
+        layers_.setValue (cfgLayer (cfg), s_key, rec.values_);
+    } else {
+        layers_.removeValue (cfgLayer (cfg), s_key);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The value that results from the layers is stored. If the file that
+ * provided the record also provides the resulting value the typed
+ * conversions stored in its cache are reused.
+ *
+ * @param opt definition of the option
+ * @param cfg the most specific file that has the option (-1 if none)
+ * @param rec what that file knows about the option
+ */
+void AppOpts::materializeCfgValue (
+        const OneOpt & opt, int cfg, const OptBinCache::Record & rec)
+{
+    QString s_key = opt.fullName();
+    uint hash = opt.fullHash();
+    materialize (s_key, hash);
+    if ((cfg != -1) && rec.present_ && (rec.typed_ != 0) &&
+            (layers_.origin (s_key) == cfgLayer (cfg))) {
+        table_.primeTyped (table_.find (s_key, hash), rec.typed_,
+                           rec.int_, rec.dbl_, rec.bool_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The value goes into the layer of the file and the option is stored
+ * right away.
+ *
+ * @param cfg one of the CfgFile values
+ * @param opt definition of the option
+ * @param rec what is known about the option
+ */
+void AppOpts::storeCfgValue (
+        int cfg, const OneOpt & opt, const OptBinCache::Record & rec)
+{
+    setCfgLayer (cfg, opt.fullName (), rec);
+    materializeCfgValue (opt, cfg, rec);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Used by the getters in lazy mode. The option had no value, so no layer
+ * above the file has it either and the value of the file is the value of
+ * the option. Filling it in is not a change: no snapshot is published,
+ * subscribers are not informed and the sorted map is left alone; only
+ * the group index is updated, so that the group methods list the option.
+ * The option is remembered (without a default value), so reloads of the
+ * files refresh it like the options read by `readValueFromCfgs()`.
+ *
+ * @param cfg one of the CfgFile values
+ * @param opt definition of the option
+ * @param rec what the file knows about the option; must be present
+ */
+void AppOpts::storeLazy (
+        int cfg, const OneOpt & opt, const OptBinCache::Record & rec)
+{
+    QString s_key = opt.fullName();
+    uint hash = opt.fullHash();
+    if (!known_index_.contains (s_key)) {
+        known_index_.insert (s_key, known_.count ());
+        known_.append (opt);
+    }
+    layers_.setValue (cfgLayer (cfg), s_key, rec.values_);
+    QStringList sl;
+    if (!layers_.resolve (s_key, &sl))
+        return;
+    int i_slot = table_.slot (s_key, hash);
+    table_.setValues (i_slot, sl);
+    if ((rec.typed_ != 0) && (layers_.origin (s_key) == cfgLayer (cfg))) {
+        table_.primeTyped (i_slot, rec.typed_,
+                           rec.int_, rec.dbl_, rec.bool_);
+    }
+    updateTrie ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called when the file is replaced or reloaded.
+ *
+ * @param cfg one of the CfgFile values
+ */
+void AppOpts::resetBinCache (int cfg)
+{
+    BinCacheState & st = bin_state_[cfg];
+    delete st.cache_;
+    st.cache_ = NULL;
+    st.path_.clear ();
+    st.version_.clear ();
+    st.source_ = OptBinCache::Source ();
+    st.records_.clear ();
+    st.dirty_ = false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Slots are never moved or removed from the table, so only the slots
+ * created after the previous call need to be indexed; the keys of removed
+ * options stay in the index and are skipped by the callers, as their
+ * entries have no value. The method is called each time a value changes
+ * and when an option is read on demand, so the const group methods never
+ * update the index.
+ */
+void AppOpts::updateTrie ()
+{
+    int i_max = table_.slotCount ();
+    for (; trie_slots_ < i_max; ++trie_slots_) {
+        trie_.insert (table_.entry (trie_slots_).key_, trie_slots_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The group may have several segments (`tenant/database`); all options
+ * below it are listed, in segment order. The cost depends on the number of
+ * segments in the name of the group and on the size of the group, not on
+ * the total number of options.
+ *
+ * @param s_group name of the group
+ * @return full names of the options
+ */
+QStringList AppOpts::keysInGroup (const QString & s_group) const
+{
+    QStringList result;
+    foreach (int i_slot, trie_.slotsUnder (s_group)) {
+        const OptTable::Entry & e = table_.entry (i_slot);
+        if (e.present_) {
+            result.append (e.key_);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_group name of the group
+ * @return the values by full name
+ */
+QMap<QString,QStringList> AppOpts::valuesInGroup (const QString & s_group) const
+{
+    QMap<QString,QStringList> result;
+    foreach (int i_slot, trie_.slotsUnder (s_group)) {
+        const OptTable::Entry & e = table_.entry (i_slot);
+        if (e.present_) {
+            result.insert (e.key_, e.values_);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The result is a copy of the current values of the group that does not
+ * change with this instance; the group prefix is removed from the keys,
+ * so the subtree can be stored under a different group.
+ *
+ * @param s_group name of the group
+ * @return the values by name relative to the group
+ */
+QMap<QString,QStringList> AppOpts::exportGroup (const QString & s_group) const
+{
+    QMap<QString,QStringList> result;
+    QString s_prefix = s_group;
+    if (!s_prefix.isEmpty () && !s_prefix.endsWith (QChar('/'))) {
+        s_prefix.append (QChar('/'));
+    }
+    foreach (int i_slot, trie_.slotsUnder (s_group)) {
+        const OptTable::Entry & e = table_.entry (i_slot);
+        if (e.present_) {
+            result.insert (e.key_.mid (s_prefix.length ()), e.values_);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The option is removed from every layer, including the defaults, so it
+ * stays removed until a source provides it again. Unlike the setters
+ * this is not staged by a transaction.
+ *
+ * @param s_key full name of the option
+ * @return true if the option had a value
+ */
+bool AppOpts::removeValue (const QString & s_key)
+{
+    for (int layer = 0; layer < OptLayers::LayerCount; ++layer) {
+        layers_.removeValue (layer, s_key);
+    }
+    if (lazy_load_) {
+        lazy_absent_.insert (s_key);
+    }
+    int i_slot = table_.find (s_key);
+    if (table_.values (i_slot) == NULL) {
+        return false;
+    }
+    eraseValue (s_key);
+    if (saver_ != NULL) {
+        saver_->markDirty (s_key);
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The options are removed from every layer, including the defaults,
+ * so they stay removed until a source provides them again. All changes
+ * are made in a single batch.
+ *
+ * @param s_group name of the group
+ * @return number of options that had a value
+ */
+int AppOpts::removeGroup (const QString & s_group)
+{
+    int i_removed = 0;
+    beginBatch ();
+    foreach (int i_slot, trie_.slotsUnder (s_group)) {
+        if (removeValue (table_.entry (i_slot).key_)) {
+            ++i_removed;
         }
     }
+    endBatch ();
+    return i_removed;
 }
 /* ========================================================================= */
 
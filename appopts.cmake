@@ -20,12 +20,43 @@ macro    (appoptsInit
     set(APPOPTS_HEADERS
         appopts.h
         one_opt.h
-        one_opt_list.h)
+        one_opt_list.h
+        one_opt_indexed_list.h
+        opt_table.h
+        opt_handle.h
+        opt_snapshot.h
+        opt_watcher.h
+        opt_layers.h
+        opt_bincache.h
+        opt_saver.h
+        opt_arena.h
+        opt_trie.h
+        opt_schema.h
+        opt_metrics.h
+        opt_trace.h
+        opt_overrides.h
+        opt_constraints.h
+        opt_validator.h
+        opt_changes.h)
 
     set(APPOPTS_SOURCES
         appopts.cc
         one_opt.cc
-        one_opt_list.cc)
+        one_opt_list.cc
+        one_opt_indexed_list.cc
+        opt_table.cc
+        opt_snapshot.cc
+        opt_watcher.cc
+        opt_layers.cc
+        opt_bincache.cc
+        opt_saver.cc
+        opt_arena.cc
+        opt_trie.cc
+        opt_metrics.cc
+        opt_trace.cc
+        opt_overrides.cc
+        opt_validator.cc
+        opt_changes.cc)
 
     pileSetSources(
         "${APPOPTS_INIT_NAME}"
@@ -11,8 +11,23 @@
 #define GUARD_APPOPTS_H_INCLUDE
 
 #include <appopts/appopts-config.h>
+#include <appopts/opt_table.h>
+#include <appopts/opt_handle.h>
+#include <appopts/opt_snapshot.h>
+#include <appopts/opt_watcher.h>
+#include <appopts/opt_layers.h>
+#include <appopts/opt_bincache.h>
+#include <appopts/opt_saver.h>
+#include <appopts/opt_trie.h>
+#include <appopts/opt_metrics.h>
+#include <appopts/opt_changes.h>
+#include <appopts/one_opt_list.h>
 
 #include <QMap>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 
@@ -20,19 +35,46 @@ class UserMsg;
 class PerSt;
 class OneOpt;
 class OneOptList;
+class OptOverrides;
+class OptValidator;
 
 //! Application options.
-class APPOPTS_EXPORT AppOpts : public QMap<QString,QStringList> {
+class APPOPTS_EXPORT AppOpts {
 
+    friend class OptWatcher;
+    friend class OptSaver;
+
+public:
+
+    //! The configuration files that are merged; most specific last.
+    enum CfgFile {
+        SystemCfg = 0, /**< the file in system data directory */
+        UserCfg, /**< the file in user home directory */
+        LocalCfg, /**< the file in current directory */
+        CfgFileCount /**< number of files */
+    };
 
 private:
 
     //! copy constructor
     AppOpts (const AppOpts & other) :
+        snapshot_mode_(false),
+        batch_depth_(0),
+        batch_changed_(false),
+        txn_open_(false),
+        parallel_load_(other.parallel_load_),
+        bin_cache_(other.bin_cache_),
+        lazy_load_(other.lazy_load_),
+        watcher_(NULL),
+        saver_(NULL),
+        trie_slots_(0),
+        metrics_(NULL),
+        changes_(NULL),
         system_file_(other.system_file_),
         user_file_(other.user_file_),
         local_file_(other.local_file_),
-        current_file_(other.current_file_)
+        current_file_(other.current_file_),
+        current_cfg_(other.current_cfg_)
     {}
 
     //! assignment operator
@@ -41,6 +83,7 @@ private:
         user_file_ = other.user_file_;
         local_file_ = other.local_file_;
         current_file_ = other.current_file_;
+        current_cfg_ = other.current_cfg_;
         return *this;
     }
 
@@ -58,6 +101,44 @@ public:
             UserMsg & um,
             const QString & s_app_name = QString());
 
+    //! Are the files located and parsed concurrently by loadFromAll()?
+    inline bool
+    parallelLoad () const {
+        return parallel_load_;
+    }
+
+    //! Locate and parse the files concurrently in loadFromAll().
+    void
+    setParallelLoad (
+            bool b_enable);
+
+    //! Are binary caches of the configuration files used?
+    inline bool
+    binaryCache () const {
+        return bin_cache_;
+    }
+
+    //! Use binary caches of the configuration files in loadFromAll().
+    void
+    setBinaryCache (
+            bool b_enable);
+
+    //! Do the getters read missing options from the files?
+    inline bool
+    lazyLoad () const {
+        return lazy_load_;
+    }
+
+    //! Let the getters read options that have no value from the files.
+    void
+    setLazyLoad (
+            bool b_enable);
+
+    //! Write the binary caches of the configuration files that changed.
+    bool
+    writeBinaryCaches (
+            UserMsg & um);
+
     //! Load options from a file.
     bool
     loadFile (
@@ -77,6 +158,18 @@ public:
             const OneOptList & optlist,
             UserMsg & um);
 
+    //! Check the values of the options in a list against their constraints.
+    bool
+    validate (
+            const OneOptList & optlist,
+            UserMsg & um) const;
+
+    //! Check the values against precompiled constraints.
+    bool
+    validate (
+            const OptValidator & validator,
+            UserMsg & um) const;
+
     //! Set a value.
     void
     setValue (
@@ -101,6 +194,44 @@ public:
             const QString & s_key,
             const QStringList & sl_values);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! Set a value, taking over the list.
+    void
+    setValue (
+            const QString & s_key,
+            QStringList && sl_value);
+
+    //! Append values, taking over the list.
+    void
+    appendValues (
+            const QString & s_key,
+            QStringList && sl_values);
+#endif
+
+    //! Stage the changes made by the setters instead of applying them.
+    bool
+    beginTransaction ();
+
+    //! Is a transaction open?
+    inline bool
+    inTransaction () const {
+        return txn_open_;
+    }
+
+    //! Number of options changed in the open transaction.
+    inline int
+    stagedCount () const {
+        return txn_order_.count ();
+    }
+
+    //! Apply all staged changes at once.
+    QList<OptChange>
+    commitTransaction ();
+
+    //! Discard all staged changes.
+    void
+    rollbackTransaction ();
+
     //! Set current file.
     bool
     setCurrentConfig (
@@ -137,6 +268,66 @@ public:
             const QString & s_name,
             double d_default = 0.0) const;
 
+    //! Resolve the name of an option into a handle.
+    OptHandle
+    handle (
+            const QString & s_name);
+
+    //! Resolve an option definition into a handle.
+    OptHandle
+    handle (
+            const OneOpt & opt);
+
+    //! Get a Boolean value based on option's handle.
+    bool
+    valueB (
+            OptHandle h,
+            bool b_default = false) const;
+
+    //! Get a string value based on option's handle.
+    QString
+    valueS (
+            OptHandle h,
+            const QString & s_default = QString()) const;
+
+    //! Get a list of strings based on option's handle.
+    QStringList
+    valueSL (
+            OptHandle h,
+            const QStringList & sl_default = QStringList()) const;
+
+    //! Get an integer value based on option's handle.
+    int
+    valueI (
+            OptHandle h,
+            int i_default = 0) const;
+
+    //! Get a double value based on option's handle.
+    double
+    valueD (
+            OptHandle h,
+            double d_default = 0.0) const;
+
+    //! Reference to the first value of an option; no copy is made.
+    const QString &
+    valueSRef (
+            const QString & s_name) const;
+
+    //! Reference to the first value of an option; no copy is made.
+    const QString &
+    valueSRef (
+            OptHandle h) const;
+
+    //! Reference to the values of an option; no copy is made.
+    const QStringList &
+    valueSLRef (
+            const QString & s_name) const;
+
+    //! Reference to the values of an option; no copy is made.
+    const QStringList &
+    valueSLRef (
+            OptHandle h) const;
+
 public:
 
     //! Get a proper name starting from a template.
@@ -144,22 +335,620 @@ public:
     cfgFileName (
             const QString &s_app_name);
 
+    //! Sorted copy of the options, built on each call.
+    inline QMap<QString,QStringList>
+    toMap () const {
+        return table_.toMap ();
+    }
+
+    //! The names of the options that have a value, sorted.
+    inline QStringList
+    sortedKeys () const {
+        return table_.sortedKeys ();
+    }
+
+    //! Same as `sortedKeys()`; kept for code written against the QMap base.
+    inline QStringList
+    keys () const {
+        return table_.sortedKeys ();
+    }
+
+    //! Does the option have a value?
+    inline bool
+    contains (
+            const QString & s_key) const {
+        return table_.values (table_.find (s_key)) != NULL;
+    }
+
+    //! Number of options that have a value.
+    inline int
+    count () const {
+        return table_.count ();
+    }
+
+    //! Number of options that have a value.
+    inline int
+    size () const {
+        return table_.count ();
+    }
+
+    //! Are there no options with a value?
+    inline bool
+    isEmpty () const {
+        return table_.count () == 0;
+    }
+
+    //! The value of an option (\b sl_default if it has none).
+    inline QStringList
+    value (
+            const QString & s_key,
+            const QStringList & sl_default = QStringList()) const {
+        return valueSL (s_key, sl_default);
+    }
+
+    //! The value of an option (an empty list if it has none).
+    inline const QStringList
+    operator[] (
+            const QString & s_key) const {
+        return valueSL (s_key);
+    }
+
+    //! Same as `setValue()`; kept for code written against the QMap base.
+    QT_DEPRECATED inline void
+    insert (
+            const QString & s_key,
+            const QStringList & sl_value) {
+        setValue (s_key, sl_value);
+    }
+
+    //! Same as `removeValue()`; kept for code written against the QMap base.
+    QT_DEPRECATED inline int
+    remove (
+            const QString & s_key) {
+        return removeValue (s_key) ? 1 : 0;
+    }
+
+    //! Does nothing; the table is the only storage.
+    QT_DEPRECATED void
+    reindex ();
+
+    //! The hash table that backs the getters.
+    inline const OptTable &
+    table () const {
+        return table_;
+    }
+
+    //! Publish a snapshot after each change?
+    inline bool
+    snapshotMode () const {
+        return snapshot_mode_;
+    }
+
+    //! Enable or disable publishing a snapshot after each change.
+    void
+    setSnapshotMode (
+            bool b_enable);
+
+    //! Publish current values for lock-free readers.
+    void
+    publish ();
+
+    //! The snapshots published by this instance.
+    inline const OptSnapshot &
+    snapshot () const {
+        return snapshot_;
+    }
+
+    //! Get a value by walking the layers; reports where it came from.
+    bool
+    layeredValue (
+            const QString & s_name,
+            QStringList & sl_out,
+            int * layer = NULL) const;
+
+    //! The layer that provides the value of an option.
+    int
+    valueOrigin (
+            const QString & s_name) const;
+
+    //! The values for each source.
+    inline const OptLayers &
+    layers () const {
+        return layers_;
+    }
+
+    //! Replace all values coming from one source.
+    void
+    replaceLayer (
+            int layer,
+            const QHash<QString,QStringList> & values);
+
+    //! Remove all values coming from one source.
+    void
+    dropLayer (
+            int layer);
+
+    //! Take values for known options from arguments and environment.
+    bool
+    loadOverrides (
+            const OneOptList & schema,
+            const QStringList & args,
+            UserMsg & um,
+            const QString & s_app_name = QString(),
+            bool b_strict = false);
+
+    //! Make parsed overrides the command line layer.
+    void
+    applyOverrides (
+            const OptOverrides & overrides);
+
+    //! Full names of the options with a value in a group.
+    QStringList
+    keysInGroup (
+            const QString & s_group) const;
+
+    //! The options with a value in a group, by full name.
+    QMap<QString,QStringList>
+    valuesInGroup (
+            const QString & s_group) const;
+
+    //! The options with a value in a group, by name relative to the group.
+    QMap<QString,QStringList>
+    exportGroup (
+            const QString & s_group) const;
+
+    //! Remove an option from all sources.
+    bool
+    removeValue (
+            const QString & s_key);
+
+    //! Remove all options in a group from all sources.
+    int
+    removeGroup (
+            const QString & s_group);
+
+    //! Are configuration files watched for changes?
+    inline bool
+    hotReload () const {
+        return watcher_ != NULL;
+    }
+
+    //! Watch the configuration files and reload them when they change.
+    void
+    setHotReload (
+            bool b_enable);
+
+    //! Are changed values written back to the current file?
+    inline bool
+    writeBack () const {
+        return saver_ != NULL;
+    }
+
+    //! Write changed values back to the current file.
+    void
+    setWriteBack (
+            bool b_enable,
+            int i_delay_ms = 500,
+            bool b_async = true);
+
+    //! Write the changes that are pending now.
+    bool
+    saveChanges (
+            UserMsg & um);
+
+    //! Are reads of options counted?
+    inline bool
+    metricsEnabled () const {
+        return metrics_ != NULL;
+    }
+
+    //! Count reads, misses, default fallbacks and parse failures.
+    void
+    setMetrics (
+            bool b_enable);
+
+    //! The counters (NULL if metrics are disabled).
+    inline const OptMetrics *
+    metrics () const {
+        return metrics_;
+    }
+
+    //! Set all counters to zero.
+    void
+    resetMetrics ();
+
+    //! The counters as JSON (empty if metrics are disabled).
+    QByteArray
+    metricsJson () const;
+
+    //! Inform a listener when the value of an option changes.
+    void
+    subscribe (
+            const QString & s_key,
+            OptChangeListener * listener,
+            OptChanges::Delivery delivery = OptChanges::SyncDelivery);
+
+    //! Inform a listener when the value of an option in a group changes.
+    void
+    subscribeGroup (
+            const QString & s_group,
+            OptChangeListener * listener,
+            OptChanges::Delivery delivery = OptChanges::SyncDelivery);
+
+    //! Remove all subscriptions of a listener.
+    void
+    unsubscribe (
+            OptChangeListener * listener);
+
+    //! Deliver queued changes without waiting for the event loop.
+    void
+    deliverChanges ();
+
+    //! Add an object to be informed about reloads.
+    void
+    addReloadListener (
+            OptReloadListener * listener);
+
+    //! Remove an object added with addReloadListener().
+    void
+    removeReloadListener (
+            OptReloadListener * listener);
+
+    //! Create a PerSt instance for a file and read its version.
+    static PerSt *
+    parseCfgFile (
+            const QString & s_file,
+            QString * s_version,
+            QString * s_error);
+
+    //! Read the value of an option from a PerSt instance.
+    static bool
+    valueFromPerSt (
+            PerSt * perst,
+            const OneOpt & opt,
+            QStringList & sl_out);
+
 protected:
 
 
 private:
 
-    //! Uses one Perst instance to find requested option.
+    //! Uses one of the configuration files to find requested option.
+    bool
+    readValueFromCfg (
+            int cfg,
+            const OneOpt & opt,
+            OptBinCache::Record & rec,
+            UserMsg & um);
+
+    //! State of locating and parsing one configuration file.
+    struct CfgLoad {
+        int cfg_; /**< one of the CfgFile values */
+        QString s_file_name_; /**< name of the file to look for */
+        QString s_path_; /**< path where the file was found */
+        PerSt * perst_; /**< the parsed file (NULL if cache_ is used) */
+        bool use_cache_; /**< look for a binary cache */
+        OptBinCache::Source source_; /**< identity of the file */
+        OptBinCache * cache_; /**< fresh binary cache or NULL */
+        QString s_version_; /**< version found in the file */
+        QString s_error_; /**< the error if the file can't be used */
+        qint64 locate_ns_; /**< time spent locating the file */
+        qint64 parse_ns_; /**< time spent parsing the file */
+    };
+
+    class CfgLoadJob;
+
+    //! What is known about the binary cache of a configuration file.
+    struct BinCacheState {
+        BinCacheState () : cache_(NULL), dirty_(false) {}
+        OptBinCache * cache_; /**< fresh cache or NULL */
+        QString path_; /**< path of the source file */
+        OptBinCache::Source source_; /**< identity of the source file */
+        QString version_; /**< version of the source file */
+        QHash<QString,OptBinCache::Record> records_; /**< new lookups */
+        bool dirty_; /**< records_ holds keys missing from cache_ */
+    };
+
+    //! Create a PerSt instance, using a fresh binary cache if asked to.
+    static PerSt *
+    openCfgFile (
+            const QString & s_file,
+            bool b_use_cache,
+            OptBinCache::Source * source,
+            QString * s_version,
+            QString * s_error,
+            OptBinCache ** out_cache);
+
+    //! Read an option from one of the configuration files or its cache.
+    bool
+    lookupCfgValue (
+            int cfg,
+            const OneOpt & opt,
+            OptBinCache::Record & rec);
+
+    //! Put a value read from one of the configuration files in its layer.
+    void
+    setCfgLayer (
+            int cfg,
+            const QString & s_key,
+            const OptBinCache::Record & rec);
+
+    //! Store the value of an option after its file layers were set.
+    void
+    materializeCfgValue (
+            const OneOpt & opt,
+            int cfg,
+            const OptBinCache::Record & rec);
+
+    //! Store a value read from one of the configuration files.
+    void
+    storeCfgValue (
+            int cfg,
+            const OneOpt & opt,
+            const OptBinCache::Record & rec);
+
+    //! Store a value that a getter read from one of the configuration files.
+    void
+    storeLazy (
+            int cfg,
+            const OneOpt & opt,
+            const OptBinCache::Record & rec);
+
+    //! Forget the binary cache of a configuration file.
+    void
+    resetBinCache (
+            int cfg);
+
+    //! Locate and parse one of the configuration files.
+    static void
+    locateAndParse (
+            CfgLoad & load);
+
+    //! The path of one of the configuration files (empty if not found).
+    static QString
+    locateCfgFile (
+            int cfg,
+            const QString & s_file_name);
+
+    //! Forget about a file that was located and parsed.
+    static void
+    discardLoad (
+            CfgLoad & load);
+
+    //! Make a parsed file one of the configuration files.
+    bool
+    applyLoad (
+            CfgLoad & load,
+            UserMsg & um);
+
+    //! Reads the values of many options from one file in a single pass.
+    void
+    readGroupsFromCfg (
+            int cfg,
+            const OneOptList & list,
+            const QMap<QString, QList<int> > & groups,
+            QVector<int> & found,
+            QVector<OptBinCache::Record> & recs,
+            UserMsg & um);
+
+    //! Remember the definition of an option for reloads.
+    void
+    rememberOpt (
+            const OneOpt & opt);
+
+    //! Handle an option that was not found in any file.
     bool
-    readValueFromPerSt (
-            PerSt *perst,
+    useDefault (
             const OneOpt & opt,
             UserMsg & um);
 
+    //! The layer of a configuration file.
+    static inline int
+    cfgLayer (
+            int cfg) {
+        return OptLayers::SystemLayer + cfg;
+    }
+
+    //! Store the value that results from the layers.
+    inline void
+    materialize (
+            const QString & s_key) {
+        materialize (s_key, OptTable::hashKey (s_key));
+    }
+
+    //! Store the value that results from the layers (precomputed hash).
+    void
+    materialize (
+            const QString & s_key,
+            uint hash);
+
+    //! Remove the value of an option from the table.
+    inline void
+    eraseValue (
+            const QString & s_key) {
+        eraseValue (s_key, OptTable::hashKey (s_key));
+    }
+
+    //! Remove the value of an option (precomputed hash).
+    void
+    eraseValue (
+            const QString & s_key,
+            uint hash);
+
+    //! Replace the value of an option in the table.
+    inline void
+    storeValue (
+            const QString & s_key,
+            const QStringList & sl_value) {
+        storeValue (s_key, sl_value, OptTable::hashKey (s_key));
+    }
+
+    //! Replace the value of an option (precomputed hash).
+    void
+    storeValue (
+            const QString & s_key,
+            const QStringList & sl_value,
+            uint hash);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! Replace the value of an option, taking over the list.
+    void
+    storeValue (
+            const QString & s_key,
+            QStringList && sl_value,
+            uint hash);
+#endif
+
+    //! Append to the value of an option in the table.
+    void
+    storeAppend (
+            const QString & s_key,
+            const QStringList & sl_value);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! Append to the value of an option, taking over the list if possible.
+    void
+    storeAppend (
+            const QString & s_key,
+            QStringList && sl_value);
+#endif
+
+    //! An option is about to change; let the subscribers know its value.
+    inline void
+    recordChange (
+            const QString & s_key,
+            int i_slot) {
+        if (changes_ != NULL) {
+            changes_->record (s_key, table_.values (i_slot));
+        }
+    }
+
+    //! Remember a change made inside a transaction.
+    void
+    stageValue (
+            const QString & s_key,
+            const QStringList & sl_value,
+            bool b_append);
+
+    //! Called after the values were changed.
+    void
+    valuesChanged ();
+
+    //! Defer the effects of changes until the matching `endBatch()`.
+    void
+    beginBatch ();
+
+    //! Apply the effects of deferred changes.
+    void
+    endBatch ();
+
+    //! The member that holds one of the configuration files.
+    PerSt **
+    cfgSlot (
+            int cfg);
+
+    //! The member that holds one of the configuration files.
+    PerSt * const *
+    cfgSlot (
+            int cfg) const;
+
+    //! One of the configuration files, parsed if only its cache was used.
+    PerSt *
+    cfgFile (
+            int cfg);
+
+    //! Was one of the configuration files loaded?
+    bool
+    hasCfgFile (
+            int cfg) const;
+
+    //! The path of one of the configuration files.
+    QString
+    cfgLocation (
+            int cfg) const;
+
+    //! The path of the file where changes are saved.
+    QString
+    currentLocation () const;
+
+    //! Apply the result of reloading a file.
+    void
+    applyReload (
+            const OptWatcher::Result & result);
+
+    //! Locate the slot of an option for a getter; counts unknown names.
+    ///
+    /// In lazy mode this is the only place where a const method changes
+    /// the instance: the option is read through `lazyValue()`.
+    inline int
+    slotForRead (
+            const QString & s_name) const {
+        int i_slot = table_.find (s_name);
+        if (lazy_load_ && (table_.values (i_slot) == NULL)) {
+            i_slot = const_cast<AppOpts *> (this)->lazyValue (s_name);
+        }
+        if ((i_slot == -1) && (metrics_ != NULL)) {
+            metrics_->addUnknownName (s_name);
+        }
+        return i_slot;
+    }
+
+    //! Read an option that has no value from the files.
+    int
+    lazyValue (
+            const QString & s_name);
+
+    //! In lazy mode, read an option from the files if it has no value.
+    inline void
+    loadLazily (
+            const QString & s_key) {
+        if (lazy_load_ && (table_.values (table_.find (s_key)) == NULL)) {
+            lazyValue (s_key);
+        }
+    }
+
+    //! Count a getter that returned the default value.
+    void
+    countDefault (
+            int i_slot,
+            bool b_converted) const;
+
+    //! Add the slots created since last call to the group index.
+    void
+    updateTrie ();
+
+    //! Let the watcher know about the files that were loaded.
+    void
+    watchCfgFiles ();
+
+    OptTable table_; /**< hashed storage used by the getters */
+    OptSnapshot snapshot_; /**< published tables for concurrent readers */
+    bool snapshot_mode_; /**< publish after each change */
+    int batch_depth_; /**< nesting level of beginBatch() */
+    bool batch_changed_; /**< values changed inside current batch */
+    bool txn_open_; /**< setters stage their changes */
+    QStringList txn_order_; /**< staged options, in order of first change */
+    QHash<QString,QStringList> txn_values_; /**< staged values by full name */
+    bool parallel_load_; /**< load files concurrently */
+    bool bin_cache_; /**< use binary caches of the files */
+    bool lazy_load_; /**< getters read missing options from the files */
+    QSet<QString> lazy_absent_; /**< options that no file provides */
+    BinCacheState bin_state_[CfgFileCount]; /**< binary caches of the files */
+    OneOptList known_; /**< options read from files, in order */
+    QHash<QString,int> known_index_; /**< index in known_ by full name */
+    OptLayers layers_; /**< values for each source */
+    OptWatcher * watcher_; /**< reloads files that change (may be NULL) */
+    QList<OptReloadListener*> reload_listeners_; /**< informed on reloads */
+    OptSaver * saver_; /**< writes changes back (may be NULL) */
+    OptTrie trie_; /**< table slots by group (append-only) */
+    int trie_slots_; /**< number of table slots in trie_ */
+    OptMetrics * metrics_; /**< read counters (may be NULL) */
+    OptChanges * changes_; /**< change subscriptions (may be NULL) */
     PerSt * system_file_; /**< configuration file at system level */
     PerSt * user_file_; /**< configuration file at user level */
     PerSt * local_file_; /**< configuration file at local level */
-    PerSt * current_file_; /**< current used for saving things */
+    PerSt * current_file_; /**< current file loaded by setCurrentConfig() */
+    int current_cfg_; /**< CfgFile used for saving things (-1 if none) */
 
 public: virtual void anchorVtable() const;
 };
@@ -0,0 +1,824 @@
+/**
+ * @file appopts_bench.cc
+ * @brief Benchmarks for the AppOpts pile.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include <appopts/appopts.h>
+#include <appopts/opt_table.h>
+#include <appopts/opt_arena.h>
+#include <appopts/opt_schema.h>
+#include <appopts/one_opt_list.h>
+#include <appopts/opt_trace.h>
+
+#include <usermsg/usermsg.h>
+
+#include "opt_datagen.h"
+
+#include <QtTest>
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <functional>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+APPOPTS_OPTION(BenchPort, int, "network", "port", 8080, "Listening port");
+APPOPTS_OPTION(BenchRatio, double, "network", "ratio", 0.5, "Retry ratio");
+APPOPTS_OPTION(BenchVerbose, bool, "general", "verbose", false, "Print more");
+typedef OptSchema<BenchPort, BenchRatio, BenchVerbose> BenchSchema;
+
+//! Runs one function in a thread.
+class BenchThread : public QThread {
+public:
+    explicit BenchThread (const std::function<void ()> & fn) :
+        QThread (), fn_(fn)
+    {}
+protected:
+    void run () { fn_ (); }
+private:
+    std::function<void ()> fn_;
+};
+
+//! Runs `fn` in `thread_count` threads; returns wall time in nanoseconds.
+static qint64 runInThreads (
+        int thread_count, const std::function<void ()> & fn)
+{
+    QList<BenchThread*> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.append (new BenchThread (fn));
+    }
+    QElapsedTimer timer;
+    timer.start ();
+    foreach (BenchThread * t, threads) {
+        t->start ();
+    }
+    foreach (BenchThread * t, threads) {
+        t->wait ();
+    }
+    qint64 elapsed = timer.nsecsElapsed ();
+    qDeleteAll (threads);
+    return elapsed;
+}
+
+//! Makes a directory current and restores the previous one on exit,
+//! including an early return from a failed QVERIFY.
+class BenchCurrentDir {
+public:
+    explicit BenchCurrentDir (const QString & s_path) :
+        s_prev_(QDir::currentPath ())
+    {
+        QDir::setCurrent (s_path);
+    }
+    ~BenchCurrentDir () {
+        QDir::setCurrent (s_prev_);
+    }
+private:
+    QString s_prev_;
+};
+
+//! Results are accumulated here so that the loops are not optimized away.
+static QAtomicInt bench_sink;
+
+//! Number of reads performed by each thread in threaded benchmarks.
+#define BENCH_READS_PER_THREAD 2000000
+
+//! Bytes currently allocated from the heap, including allocator overhead.
+static qint64 heapBytes ()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2 ().uordblks;
+#elif defined(__GLIBC__)
+    return mallinfo ().uordblks;
+#else
+    return 0;
+#endif
+}
+
+//! Benchmarks for the AppOpts pile.
+class AppOptsBench : public QObject {
+    Q_OBJECT
+
+private:
+
+    //! Data rows for benchmarks that scale with the number of keys.
+    static void
+    sizeRows () {
+        QTest::addColumn<int>("count");
+        QTest::newRow ("1k") << 1000;
+        QTest::newRow ("10k") << 10000;
+        QTest::newRow ("100k") << 100000;
+    }
+
+    //! Data rows for benchmarks that scale with the number of threads.
+    static void
+    threadRows () {
+        QTest::addColumn<int>("threads");
+        QTest::newRow ("1") << 1;
+        QTest::newRow ("2") << 2;
+        QTest::newRow ("4") << 4;
+        QTest::newRow ("8") << 8;
+    }
+
+    //! Data rows for memory benchmarks, one for each layout.
+    static void
+    layoutRows () {
+        QTest::addColumn<QString>("layout");
+        QTest::newRow ("map") << QString ("map");
+        QTest::newRow ("table") << QString ("table");
+        QTest::newRow ("arena") << QString ("arena");
+    }
+
+    //! One read of an option with the getter for a kind of value.
+    static double
+    readHot (
+            const AppOpts & opts,
+            int kind,
+            bool by_handle,
+            OptHandle h,
+            const QString & s_key) {
+        switch (kind) {
+        case OptDataGen::IntKind:
+            return by_handle ? opts.valueI (h) : opts.valueI (s_key);
+        case OptDataGen::DoubleKind:
+            return by_handle ? opts.valueD (h) : opts.valueD (s_key);
+        case OptDataGen::BoolKind:
+            return (by_handle ? opts.valueB (h) : opts.valueB (s_key)) ? 1 : 2;
+        case OptDataGen::StringKind:
+            return by_handle ? opts.valueS (h).length () :
+                               opts.valueS (s_key).length ();
+        default:
+            return by_handle ? opts.valueSL (h).count () :
+                               opts.valueSL (s_key).count ();
+        }
+    }
+
+    //! Data rows for read-scaling benchmarks.
+    static void
+    scalingRows () {
+        QTest::addColumn<int>("threads");
+        QTest::newRow ("1") << 1;
+        QTest::newRow ("2") << 2;
+        QTest::newRow ("4") << 4;
+        QTest::newRow ("8") << 8;
+        QTest::newRow ("16") << 16;
+        QTest::newRow ("32") << 32;
+        QTest::newRow ("64") << 64;
+    }
+
+private slots:
+
+    //! Lookups in the ordered map that used to back AppOpts.
+    void lookupMap_data () { sizeRows (); }
+    void lookupMap () {
+        QFETCH(int, count);
+        QStringList keys = OptDataGen::keys (count);
+        QMap<QString,QStringList> map;
+        foreach (const QString & s_key, keys) {
+            map.insert (s_key, QStringList (s_key));
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                if (map.find (s_key) != map.constEnd ())
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! Lookups in the hash table that backs AppOpts.
+    void lookupTable_data () { sizeRows (); }
+    void lookupTable () {
+        QFETCH(int, count);
+        QStringList keys = OptDataGen::keys (count);
+        OptTable table;
+        foreach (const QString & s_key, keys) {
+            table.setValues (table.slot (s_key), QStringList (s_key));
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                if (table.find (s_key) != -1)
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! The getters of AppOpts itself.
+    void lookupAppOpts_data () { sizeRows (); }
+    void lookupAppOpts () {
+        QFETCH(int, count);
+        QStringList keys = OptDataGen::keys (count);
+        AppOpts opts;
+        foreach (const QString & s_key, keys) {
+            opts.setValue (s_key, s_key);
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                if (!opts.valueS (s_key).isEmpty ())
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! The getters of AppOpts using pre-resolved handles.
+    void lookupHandle_data () { sizeRows (); }
+    void lookupHandle () {
+        QFETCH(int, count);
+        QStringList keys = OptDataGen::keys (count);
+        AppOpts opts;
+        QList<OptHandle> handles;
+        foreach (const QString & s_key, keys) {
+            opts.setValue (s_key, s_key);
+            handles.append (opts.handle (s_key));
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            foreach (const OptHandle & h, handles) {
+                if (!opts.valueS (h).isEmpty ())
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! Threads reading the same key through the copying getters.
+    void readCopy_data () { threadRows (); }
+    void readCopy () {
+        QFETCH(int, threads);
+        AppOpts opts;
+        opts.setValue ("general/hot", QStringList () << "some value" << "x");
+        OptHandle h = opts.handle ("general/hot");
+
+        qint64 elapsed = runInThreads (threads, [&opts, h] () {
+            int i_len = 0;
+            for (int i = 0; i < BENCH_READS_PER_THREAD; ++i) {
+                // what the getters did before: copy the list, then the string
+                QStringList sl = opts.valueSL (h);
+                QString s = sl.at (0);
+                i_len += s.length ();
+            }
+            bench_sink.fetchAndAddRelaxed (i_len);
+        });
+        qDebug () << "copy:" << threads << "threads,"
+                  << (double)elapsed / BENCH_READS_PER_THREAD << "ns/call";
+    }
+
+    //! Threads reading the same key through the non-copying getters.
+    void readRef_data () { threadRows (); }
+    void readRef () {
+        QFETCH(int, threads);
+        AppOpts opts;
+        opts.setValue ("general/hot", QStringList () << "some value" << "x");
+        OptHandle h = opts.handle ("general/hot");
+
+        qint64 elapsed = runInThreads (threads, [&opts, h] () {
+            int i_len = 0;
+            for (int i = 0; i < BENCH_READS_PER_THREAD; ++i) {
+                const QString & s = opts.valueSRef (h);
+                i_len += s.length ();
+            }
+            bench_sink.fetchAndAddRelaxed (i_len);
+        });
+        qDebug () << "ref:" << threads << "threads,"
+                  << (double)elapsed / BENCH_READS_PER_THREAD << "ns/call";
+    }
+
+    //! Startup with a 5k-option schema, one option at a time.
+    void startupPerOption () {
+        QTemporaryDir dir;
+        OneOptList schema = OptDataGen::schema (5000);
+        QVERIFY(OptDataGen::writeIni (dir.path () + "/bench.ini", schema, 2));
+        BenchCurrentDir cwd (dir.path ());
+
+        QBENCHMARK {
+            AppOpts opts;
+            UserMsg um;
+            QVERIFY(opts.loadFromAll (um, "bench"));
+            foreach (const OneOpt & opt, schema) {
+                opts.readValueFromCfgs (opt, um);
+            }
+        }
+    }
+
+    //! Startup with a 5k-option schema through the bulk loader.
+    void startupBulk () {
+        QTemporaryDir dir;
+        OneOptList schema = OptDataGen::schema (5000);
+        QVERIFY(OptDataGen::writeIni (dir.path () + "/bench.ini", schema, 2));
+        BenchCurrentDir cwd (dir.path ());
+
+        QBENCHMARK {
+            AppOpts opts;
+            UserMsg um;
+            QVERIFY(opts.loadFromAll (um, "bench"));
+            QVERIFY(opts.readMultipleFromCfgs (schema, um));
+        }
+    }
+
+    //! Heap bytes per option at 100k options for each layout.
+    void bytesPerOption_data () { layoutRows (); }
+    void bytesPerOption () {
+        QFETCH(QString, layout);
+        const int count = 100000;
+        if (heapBytes () == 0) {
+            QSKIP("Heap statistics are not available on this platform.");
+        }
+
+        qint64 before = heapBytes ();
+        qint64 bytes = 0;
+        int i_found = 0;
+        if (layout == "map") {
+            QMap<QString,QStringList> map;
+            for (int i = 0; i < count; ++i) {
+                map.insert (OptDataGen::key (i), OptDataGen::value (i));
+            }
+            bytes = heapBytes () - before;
+            i_found = map.contains (OptDataGen::key (count / 2));
+        } else if (layout == "table") {
+            OptTable table;
+            for (int i = 0; i < count; ++i) {
+                table.setValues (table.slot (OptDataGen::key (i)),
+                                 OptDataGen::value (i));
+            }
+            bytes = heapBytes () - before;
+            i_found = table.find (OptDataGen::key (count / 2)) != -1;
+        } else {
+            OptArena arena;
+            for (int i = 0; i < count; ++i) {
+                arena.insert (OptDataGen::key (i), OptDataGen::value (i));
+            }
+            bytes = heapBytes () - before;
+            i_found = arena.contains (OptDataGen::key (count / 2));
+            qDebug () << "arena: bytesUsed() reports"
+                      << (double)arena.bytesUsed () / count << "bytes/option,"
+                      << arena.groupCount () << "groups";
+        }
+        QVERIFY(i_found);
+        qDebug () << layout << ":" << (double)bytes / count << "bytes/option";
+        QTest::setBenchmarkResult ((qreal)bytes / count, QTest::BytesAllocated);
+    }
+
+    //! Heap bytes per option for building a 10k-option schema in the
+    //! default group.
+    void schemaBytes_data () {
+        QTest::addColumn<QString>("path");
+        QTest::newRow ("copy") << QString ("copy");
+        QTest::newRow ("emplace") << QString ("emplace");
+    }
+    void schemaBytes () {
+        QFETCH(QString, path);
+        const int count = 10000;
+        if (heapBytes () == 0) {
+            QSKIP("Heap statistics are not available on this platform.");
+        }
+
+        qint64 before = heapBytes ();
+        OneOptList schema;
+        if (path == "copy") {
+            // the way append() used to work: a temporary group string
+            // from the default argument, then a copy of a temporary OneOpt
+            for (int i = 0; i < count; ++i) {
+                schema.QList<OneOpt>::append (OneOpt::create (
+                        QString ("option_%1").arg (i), QString ("general"),
+                        QString (), QStringList (QString::number (i))));
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                schema.emplace (QString ("option_%1").arg (i),
+                                OneOpt::defaultGroup (),
+                                QString (), QStringList (QString::number (i)));
+            }
+        }
+        qint64 bytes = heapBytes () - before;
+        QCOMPARE(schema.count (), count);
+        qDebug () << path << ":" << (double)bytes / count << "bytes/option";
+        QTest::setBenchmarkResult ((qreal)bytes / count, QTest::BytesAllocated);
+    }
+
+    //! Typed reads through handles with and without metrics.
+    void metricsOverhead_data () {
+        QTest::addColumn<bool>("enabled");
+        QTest::newRow ("off") << false;
+        QTest::newRow ("on") << true;
+    }
+    void metricsOverhead () {
+        QFETCH(bool, enabled);
+        QStringList keys = OptDataGen::keys (1000);
+        AppOpts opts;
+        QList<OptHandle> handles;
+        foreach (const QString & s_key, keys) {
+            opts.setValue (s_key, "42");
+            handles.append (opts.handle (s_key));
+        }
+        opts.setMetrics (enabled);
+
+        qint64 i_sum = 0;
+        QBENCHMARK {
+            foreach (const OptHandle & h, handles) {
+                i_sum += opts.valueI (h);
+            }
+        }
+        QVERIFY(i_sum > 0);
+        if (enabled) {
+            QVERIFY(opts.metrics ()->value (
+                        handles.at (0).slot (), OptMetrics::Reads) > 0);
+        }
+    }
+
+    //! Lookups in the compact arena.
+    void lookupArena_data () { sizeRows (); }
+    void lookupArena () {
+        QFETCH(int, count);
+        QStringList keys = OptDataGen::keys (count);
+        OptArena arena;
+        foreach (const QString & s_key, keys) {
+            arena.insert (s_key, QStringList (s_key));
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                if (arena.find (s_key) != -1)
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! Listing one group by scanning the whole map.
+    void groupScanMap_data () { sizeRows (); }
+    void groupScanMap () {
+        QFETCH(int, count);
+        AppOpts opts;
+        foreach (const QString & s_key, OptDataGen::keys (count)) {
+            opts.setValue (s_key, s_key);
+        }
+
+        QMap<QString,QStringList> map = opts.toMap ();
+        int i_found = 0;
+        QBENCHMARK {
+            QMap<QString,QStringList>::const_iterator i = map.constBegin ();
+            QMap<QString,QStringList>::const_iterator endi = map.constEnd ();
+            for (; i != endi; ++i) {
+                if (i.key ().startsWith ("group7/"))
+                    ++i_found;
+            }
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! Listing one group through the group index.
+    void groupScanTrie_data () { sizeRows (); }
+    void groupScanTrie () {
+        QFETCH(int, count);
+        AppOpts opts;
+        foreach (const QString & s_key, OptDataGen::keys (count)) {
+            opts.setValue (s_key, s_key);
+        }
+
+        int i_found = 0;
+        QBENCHMARK {
+            i_found += opts.keysInGroup ("group7").count ();
+        }
+        QVERIFY(i_found > 0);
+    }
+
+    //! Building a 10k-entry schema and taking the full name of each entry.
+    void schemaBuild () {
+        int i_len = 0;
+        QBENCHMARK {
+            OneOptList schema = OptDataGen::schema (10000);
+            foreach (const OneOpt & opt, schema) {
+                i_len += opt.fullName ().length ();
+            }
+        }
+        QVERIFY(i_len > 0);
+    }
+
+    //! Repeated full name lookups over a 10k-entry schema.
+    void schemaFullName () {
+        OneOptList schema = OptDataGen::schema (10000);
+        int i_len = 0;
+        QBENCHMARK {
+            foreach (const OneOpt & opt, schema) {
+                i_len += opt.fullName ().length ();
+            }
+        }
+        QVERIFY(i_len > 0);
+    }
+
+    //! Bulk load of a 10k-entry schema with no config files (defaults only).
+    void schemaBulkLoad () {
+        OneOptList schema = OptDataGen::schema (10000);
+        QBENCHMARK {
+            AppOpts opts;
+            UserMsg um;
+            QVERIFY(opts.readMultipleFromCfgs (schema, um));
+        }
+    }
+
+    //! Typed reads through handles; each converts the cached string.
+    void typedHandle () {
+        AppOpts opts;
+        UserMsg um;
+        BenchSchema schema;
+        QVERIFY(schema.load (opts, um));
+        OptHandle h_port = schema.handle<BenchPort> ();
+        OptHandle h_ratio = schema.handle<BenchRatio> ();
+        OptHandle h_verbose = schema.handle<BenchVerbose> ();
+        double d_sum = 0.0;
+        QBENCHMARK {
+            for (int i = 0; i < 1000; ++i) {
+                d_sum += opts.valueI (h_port) + opts.valueD (h_ratio) +
+                        (opts.valueB (h_verbose) ? 1 : 0);
+            }
+        }
+        QVERIFY(d_sum > 0.0);
+    }
+
+    //! Typed reads through the compile-time schema.
+    void typedSchema () {
+        AppOpts opts;
+        UserMsg um;
+        BenchSchema schema;
+        QVERIFY(schema.load (opts, um));
+        double d_sum = 0.0;
+        QBENCHMARK {
+            for (int i = 0; i < 1000; ++i) {
+                d_sum += schema.get<BenchPort> () + schema.get<BenchRatio> () +
+                        (schema.get<BenchVerbose> () ? 1 : 0);
+            }
+        }
+        QVERIFY(d_sum > 0.0);
+    }
+
+    //! Locating and parsing a local file of growing size.
+    void loadFromAll_data () { sizeRows (); }
+    void loadFromAll () {
+        QFETCH(int, count);
+        QTemporaryDir dir;
+        QVERIFY(OptDataGen::writeIni (dir.path () + "/bench.ini",
+                                      OptDataGen::schema (count)));
+        BenchCurrentDir cwd (dir.path ());
+
+        QBENCHMARK {
+            AppOpts opts;
+            UserMsg um;
+            QVERIFY(opts.loadFromAll (um, "bench"));
+        }
+    }
+
+    //! Reading a large schema from a loaded file.
+    ///
+    /// If `APPOPTS_BENCH_TRACE` names a directory, one more pass is traced
+    /// and saved there as `readMultiple-<count>.json` (Chrome trace format).
+    void readMultiple_data () { sizeRows (); }
+    void readMultiple () {
+        QFETCH(int, count);
+        QTemporaryDir dir;
+        OneOptList schema = OptDataGen::schema (count);
+        QVERIFY(OptDataGen::writeIni (dir.path () + "/bench.ini", schema));
+        BenchCurrentDir cwd (dir.path ());
+
+        AppOpts opts;
+        UserMsg um;
+        QVERIFY(opts.loadFromAll (um, "bench"));
+        QBENCHMARK {
+            QVERIFY(opts.readMultipleFromCfgs (schema, um));
+        }
+
+        QString s_trace_dir = QString::fromLocal8Bit (
+                    qgetenv ("APPOPTS_BENCH_TRACE"));
+        if (!s_trace_dir.isEmpty ()) {
+            OptChromeTrace trace;
+            OptTrace::setSink (&trace);
+            AppOpts traced;
+            UserMsg um_traced;
+            traced.loadFromAll (um_traced, "bench");
+            traced.readMultipleFromCfgs (schema, um_traced);
+            OptTrace::setSink (NULL);
+            QString s_error;
+            QVERIFY2(trace.save (QString ("%1/readMultiple-%2.json")
+                                 .arg (s_trace_dir).arg (count), &s_error),
+                     qPrintable (s_error));
+        }
+    }
+
+    //! Loading a large file and using 50 of its options.
+    void workingSet_data () {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<bool>("lazy");
+        QTest::newRow ("10k-eager") << 10000 << false;
+        QTest::newRow ("10k-lazy") << 10000 << true;
+        QTest::newRow ("100k-eager") << 100000 << false;
+        QTest::newRow ("100k-lazy") << 100000 << true;
+    }
+    void workingSet () {
+        QFETCH(int, count);
+        QFETCH(bool, lazy);
+        QTemporaryDir dir;
+        OneOptList schema = OptDataGen::schema (count);
+        QVERIFY(OptDataGen::writeIni (dir.path () + "/bench.ini", schema));
+        BenchCurrentDir cwd (dir.path ());
+
+        int i_sum = 0;
+        QBENCHMARK {
+            AppOpts opts;
+            UserMsg um;
+            opts.setLazyLoad (lazy);
+            QVERIFY(opts.loadFromAll (um, "bench"));
+            if (!lazy) {
+                QVERIFY(opts.readMultipleFromCfgs (schema, um));
+            }
+            for (int i = 0; i < count; i += count / 50) {
+                i_sum += opts.valueSLRef (schema.at (i).fullName ()).count ();
+            }
+        }
+        QVERIFY(i_sum > 0);
+    }
+
+    //! Each typed getter on a hot key, by name and by handle.
+    void getterHot_data () {
+        QTest::addColumn<int>("kind");
+        QTest::addColumn<bool>("by_handle");
+        static const char * const names[OptDataGen::KindCount] = {
+            "valueI", "valueD", "valueB", "valueS", "valueSL"
+        };
+        for (int kind = 0; kind < OptDataGen::KindCount; ++kind) {
+            QTest::newRow ((QByteArray (names[kind]) + "/name").constData ())
+                    << kind << false;
+            QTest::newRow ((QByteArray (names[kind]) + "/handle").constData ())
+                    << kind << true;
+        }
+    }
+    void getterHot () {
+        QFETCH(int, kind);
+        QFETCH(bool, by_handle);
+        AppOpts opts;
+        for (int i = 0; i < 1000; ++i) {
+            opts.setValue (OptDataGen::key (i), OptDataGen::value (i));
+        }
+        // the option at index `kind` holds a value of that kind
+        QString s_key = OptDataGen::key (kind);
+        OptHandle h = opts.handle (s_key);
+
+        double d_sum = 0.0;
+        QBENCHMARK {
+            for (int i = 0; i < 1000; ++i) {
+                d_sum += readHot (opts, kind, by_handle, h, s_key);
+            }
+        }
+        QVERIFY(d_sum > 0.0);
+    }
+
+    //! Replacing the values of 1000 options over and over.
+    void churnSet () {
+        QStringList keys = OptDataGen::keys (1000);
+        QList<QStringList> values;
+        for (int i = 0; i < 16; ++i) {
+            values.append (OptDataGen::value (i));
+        }
+        AppOpts opts;
+        int n = 0;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                opts.setValue (s_key, values.at (n % values.count ()));
+                ++n;
+            }
+        }
+        QCOMPARE(opts.valueSLRef (keys.at (0)).isEmpty (), false);
+    }
+
+    //! Appending to 100 options, ten values each, then starting over.
+    void churnAppend () {
+        QStringList keys = OptDataGen::keys (100);
+        AppOpts opts;
+        QBENCHMARK {
+            foreach (const QString & s_key, keys) {
+                opts.setValue (s_key, QString ("start"));
+                for (int i = 0; i < 10; ++i) {
+                    opts.appendValue (s_key, QString ("more"));
+                }
+            }
+        }
+        QCOMPARE(opts.valueSLRef (keys.at (0)).count (), 11);
+    }
+
+    //! A 500-key profile applied with snapshots on, key by key or at once.
+    void applyProfile_data () {
+        QTest::addColumn<bool>("transaction");
+        QTest::newRow ("setValue") << false;
+        QTest::newRow ("transaction") << true;
+    }
+    void applyProfile () {
+        QFETCH(bool, transaction);
+        QStringList keys = OptDataGen::keys (500);
+        AppOpts opts;
+        opts.setSnapshotMode (true);
+        int seed = 0;
+        QBENCHMARK {
+            if (transaction) {
+                opts.beginTransaction ();
+            }
+            for (int i = 0; i < keys.count (); ++i) {
+                opts.setValue (keys.at (i), OptDataGen::value (i, seed));
+            }
+            if (transaction) {
+                opts.commitTransaction ();
+            }
+            ++seed;
+        }
+        OptSnapshot::Reader reader (opts.snapshot ());
+        QCOMPARE(reader.table ()->count (), keys.count ());
+    }
+
+    //! Threads reading different hot keys through the typed getters.
+    void readTyped_data () { threadRows (); }
+    void readTyped () {
+        QFETCH(int, threads);
+        AppOpts opts;
+        QStringList keys = OptDataGen::keys (64);
+        QList<OptHandle> handles;
+        foreach (const QString & s_key, keys) {
+            opts.setValue (s_key, QString ("42"));
+            handles.append (opts.handle (s_key));
+        }
+
+        QAtomicInt next (0);
+        qint64 elapsed = runInThreads (threads, [&opts, &handles, &next] () {
+            int i_mine = next.fetchAndAddRelaxed (1) % handles.count ();
+            OptHandle h = handles.at (i_mine);
+            int i_sum = 0;
+            for (int i = 0; i < BENCH_READS_PER_THREAD; ++i) {
+                i_sum += opts.valueI (h);
+            }
+            bench_sink.fetchAndAddRelaxed (i_sum);
+        });
+        qDebug () << "typed:" << threads << "threads,"
+                  << (double)elapsed / BENCH_READS_PER_THREAD << "ns/call";
+    }
+
+    //! Readers using snapshots while one thread keeps publishing changes.
+    void readSnapshot_data () { scalingRows (); }
+    void readSnapshot () {
+        QFETCH(int, threads);
+        AppOpts opts;
+        QStringList keys = OptDataGen::keys (1000);
+        foreach (const QString & s_key, keys) {
+            opts.setValue (s_key, "10");
+        }
+        OptHandle h = opts.handle (keys.at (500));
+        opts.setSnapshotMode (true);
+
+        QAtomicInt stop (0);
+        BenchThread writer ([&opts, &stop, &keys] () {
+            int i = 0;
+            while (stop.loadAcquire () == 0) {
+                opts.setValue (keys.at (i % keys.count ()),
+                               QString::number (i));
+                ++i;
+                QThread::msleep (1);
+            }
+        });
+        writer.start ();
+
+        qint64 elapsed = runInThreads (threads, [&opts, h] () {
+            int i_sum = 0;
+            for (int i = 0; i < BENCH_READS_PER_THREAD; ++i) {
+                OptSnapshot::Reader reader (opts.snapshot ());
+                i_sum += reader.valueI (h);
+            }
+            bench_sink.fetchAndAddRelaxed (i_sum);
+        });
+
+        stop.storeRelease (1);
+        writer.wait ();
+        qDebug () << "snapshot:" << threads << "threads,"
+                  << (double)elapsed / BENCH_READS_PER_THREAD << "ns/read,"
+                  << ((double)BENCH_READS_PER_THREAD * threads * 1000.0) / elapsed
+                  << "Mreads/s total";
+    }
+};
+
+QTEST_GUILESS_MAIN(AppOptsBench)
+#include "appopts_bench.moc"
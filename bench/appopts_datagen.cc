@@ -0,0 +1,64 @@
+/**
+ * @file appopts_datagen.cc
+ * @brief Writes synthetic configuration files for the AppOpts pile.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * Usage:
+ *
+ *     appopts_datagen <count> <file.ini> [step] [seed]
+ *
+ * The file holds every step-th option of a schema with `count` options
+ * (see OptDataGen), so the same command produces the same file with
+ * any release of the pile.
+ */
+
+#include "opt_datagen.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+int main (int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+    QStringList args = app.arguments ();
+    QTextStream err (stderr);
+
+    if ((args.count () < 3) || (args.count () > 5)) {
+        err << "Usage: appopts_datagen <count> <file.ini> [step] [seed]\n";
+        return 1;
+    }
+
+    bool b_ok = false;
+    int count = args.at (1).toInt (&b_ok);
+    if (!b_ok || (count < 0)) {
+        err << "The number of options must be a positive integer.\n";
+        return 1;
+    }
+    int step = 1;
+    if (args.count () > 3) {
+        step = args.at (3).toInt (&b_ok);
+        if (!b_ok || (step < 1)) {
+            err << "The step must be a positive integer.\n";
+            return 1;
+        }
+    }
+    int seed = 0;
+    if (args.count () > 4) {
+        seed = args.at (4).toInt (&b_ok);
+        if (!b_ok) {
+            err << "The seed must be an integer.\n";
+            return 1;
+        }
+    }
+
+    if (!OptDataGen::writeIni (
+                args.at (2), OptDataGen::schema (count), step, seed)) {
+        err << "Could not write " << args.at (2) << "\n";
+        return 1;
+    }
+    return 0;
+}
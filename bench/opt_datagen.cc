@@ -0,0 +1,138 @@
+/**
+ * @file opt_datagen.cc
+ * @brief Definitions for OptDataGen class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_datagen.h"
+
+#include <appopts/appopts-config.h>
+
+#include <QFile>
+#include <QTextStream>
+
+/**
+ * @class OptDataGen
+ *
+ * Used by the benchmarks and by the `appopts_datagen` tool. Values cycle
+ * through the kinds in `Kind`, so every typed getter finds options it
+ * can convert. The seed changes the values but not the keys, which
+ * allows writing several files with the same options.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param count number of keys
+ * @return `group<i % 37>/option_name_<i>` for each i
+ */
+QStringList OptDataGen::keys (int count)
+{
+    QStringList result;
+    result.reserve (count);
+    for (int i = 0; i < count; ++i) {
+        result.append (QString ("group%1/option_name_%2")
+                       .arg (i % 37).arg (i));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i index of the option
+ * @return `group<i / 100>/option_name_<i>`
+ */
+QString OptDataGen::key (int i)
+{
+    return QString ("group%1/option_name_%2").arg (i / 100).arg (i);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The default of each option is its value for seed 0.
+ *
+ * @param count number of options
+ * @param group_size number of consecutive options in a group
+ * @return the definitions, named `group<i / group_size>/option_<i>`
+ */
+OneOptList OptDataGen::schema (int count, int group_size)
+{
+    OneOptList result;
+    result.reserve (count);
+    for (int i = 0; i < count; ++i) {
+        result.emplace (QString ("option_%1").arg (i),
+                        QString ("group%1").arg (i / group_size),
+                        QString (),
+                        value (i));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i index of the option
+ * @param seed changes the value without changing its kind
+ * @return the value, as it would be read from a file
+ */
+QStringList OptDataGen::value (int i, int seed)
+{
+    // a small linear congruential step is enough to vary the digits
+    uint x = static_cast<uint>(i) * 1103515245u +
+            static_cast<uint>(seed) * 12345u + 12345u;
+    x ^= x >> 16;
+    switch (kindOf (i)) {
+    case IntKind:
+        return QStringList (QString::number (x % 100000));
+    case DoubleKind:
+        return QStringList (QString::number ((x % 100000) / 64.0, 'g', 10));
+    case BoolKind:
+        return QStringList (QString ((x & 1) ? "true" : "false"));
+    case StringKind:
+        return QStringList (QString ("a longer value %1").arg (x));
+    default:
+        return QStringList ()
+                << QString ("first%1").arg (x % 10)
+                << "second"
+                << QString::number (x % 1000);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The file has a `general` section with the version expected by AppOpts,
+ * then one section for each group. Lists are written as comma-separated
+ * values.
+ *
+ * @param s_path destination file
+ * @param schema the options
+ * @param step only every step-th option is written (1 for all)
+ * @param seed passed to `value()`
+ * @return false if the file could not be written
+ */
+bool OptDataGen::writeIni (
+        const QString & s_path, const OneOptList & schema, int step, int seed)
+{
+    QFile f (s_path);
+    if (!f.open (QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream ts (&f);
+    ts << "[general]\nperst_version=" << APPOPTS_VERSION_STRING << "\n";
+    QString s_group;
+    for (int i = 0; i < schema.count (); i += step) {
+        const OneOpt & opt = schema.at (i);
+        if (opt.group () != s_group) {
+            s_group = opt.group ();
+            ts << "\n[" << s_group << "]\n";
+        }
+        ts << opt.name () << "=" << value (i, seed).join (", ") << "\n";
+    }
+    ts.flush ();
+    return f.error () == QFile::NoError;
+}
+/* ========================================================================= */
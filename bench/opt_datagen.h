@@ -0,0 +1,74 @@
+/**
+ * @file opt_datagen.h
+ * @brief Declarations for OptDataGen class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTDATAGEN_H_INCLUDE
+#define GUARD_APPOPTS_OPTDATAGEN_H_INCLUDE
+
+#include <appopts/one_opt_list.h>
+
+#include <QString>
+#include <QStringList>
+
+//! Deterministic synthetic keys, schemas and configuration files.
+///
+/// The output only depends on the arguments, so results obtained with
+/// different releases of the pile can be compared.
+class OptDataGen {
+
+public:
+
+    //! The kinds of values produced by `value()`.
+    enum Kind {
+        IntKind = 0, /**< a small integer */
+        DoubleKind, /**< a number with decimals */
+        BoolKind, /**< `true` or `false` */
+        StringKind, /**< a sentence */
+        ListKind, /**< several strings */
+        KindCount /**< number of kinds */
+    };
+
+    //! `count` full names spread over 37 groups.
+    static QStringList
+    keys (
+            int count);
+
+    //! The full name of the i-th option in memory benchmarks.
+    static QString
+    key (
+            int i);
+
+    //! `count` definitions in groups of `group_size`.
+    static OneOptList
+    schema (
+            int count,
+            int group_size = 100);
+
+    //! The kind of value used for the i-th option.
+    static inline Kind
+    kindOf (
+            int i) {
+        return static_cast<Kind>(i % KindCount);
+    }
+
+    //! The value of the i-th option in a file with a given seed.
+    static QStringList
+    value (
+            int i,
+            int seed = 0);
+
+    //! A configuration file with the options of a schema.
+    static bool
+    writeIni (
+            const QString & s_path,
+            const OneOptList & schema,
+            int step = 1,
+            int seed = 0);
+};
+
+#endif // GUARD_APPOPTS_OPTDATAGEN_H_INCLUDE
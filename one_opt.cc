@@ -28,6 +28,15 @@
  * does NOT hold the value for the variable.
  * Lists of such instances are used to initialize the AppOpts class by only reading
  * the variables we know about.
+ *
+ * The full name (`group/name`) and its hash are computed when the name or
+ * the group are set, so that `fullName()` and `fullHash()` are cheap.
+ * The cache keeps a shallow copy of the name and group it was built from;
+ * because Qt strings detach before being modified, comparing the data
+ * pointers is enough to notice a direct change of `name_` or `group_`,
+ * in which case the full name is composed on the fly until `refresh()`
+ * is called. The cache is never changed by const methods, so instances
+ * may be shared between threads.
  */
 
 /* ------------------------------------------------------------------------- */
@@ -40,8 +49,8 @@
  * @return Newly initialized object.
  */
 OneOpt OneOpt::create (
-        const QString name, const QString stgs_group,
-        const QString description, const QStringList default_val)
+        const QString & name, const QString & stgs_group,
+        const QString & description, const QStringList & default_val)
 {
     OneOpt result;
 
@@ -49,7 +58,54 @@ OneOpt OneOpt::create (
     result.group_ = stgs_group;
     result.description_ = description;
     result.default_ = default_val;
+    result.refresh ();
+
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A single instance is shared by all the options in this group, so passing
+ * it around does not allocate.
+ *
+ * @return the name of the group
+ */
+const QString & OneOpt::defaultGroup ()
+{
+    static const QString s_general ("general");
+    return s_general;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called by the setters; needs to be called explicitly only after changing
+ * `name_` or `group_` directly.
+ */
+void OneOpt::refresh ()
+{
+    full_src_name_ = name_;
+    full_src_group_ = group_;
+    full_name_ = composeFullName ();
+    full_hash_ = OptTable::hashKey (full_name_);
+}
+/* ========================================================================= */
 
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the name if there is no group, `group/name` otherwise
+ */
+QString OneOpt::composeFullName () const
+{
+    if (group_.isEmpty ()) {
+        return name_;
+    }
+    QString result;
+    result.reserve (group_.length () + 1 + name_.length ());
+    result.append (group_);
+    result.append (QChar('/'));
+    result.append (name_);
     return result;
 }
 /* ========================================================================= */
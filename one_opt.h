@@ -11,6 +11,8 @@
 #define GUARD_APPOPTS_ONEOPT_H_INCLUDE
 
 #include <appopts/appopts-config.h>
+#include <appopts/opt_table.h>
+#include <appopts/opt_constraints.h>
 
 #include <QMap>
 #include <QList>
@@ -18,6 +20,10 @@
 #include <QSet>
 #include <QStringList>
 
+#ifdef Q_COMPILER_RVALUE_REFS
+#include <utility>
+#endif
+
 class UserMsg;
 class PerSt;
 
@@ -31,14 +37,19 @@ public:
     QString description_;
     QStringList default_;
     bool required_;
+    OptConstraints constraints_;
 
     //! Populates an instance.
     static OneOpt
     create (
-            const QString name,
-            const QString stgs_group = "general",
-            const QString description = QString(),
-            const QStringList default_val = QStringList());
+            const QString & name,
+            const QString & stgs_group = defaultGroup (),
+            const QString & description = QString(),
+            const QStringList & default_val = QStringList());
+
+    //! The group used when none is provided (`general`).
+    static const QString &
+    defaultGroup ();
 
 
     //! Default constructor.
@@ -47,8 +58,15 @@ public:
         group_(),
         description_(),
         default_(),
-        required_(false)
-    {}
+        required_(false),
+        constraints_(),
+        full_name_(),
+        full_hash_(0),
+        full_src_name_(),
+        full_src_group_()
+    {
+        refresh ();
+    }
 
     //! copy constructor
     ///
@@ -57,7 +75,12 @@ public:
         group_(other.group_),
         description_(other.description_),
         default_(other.default_),
-        required_(other.required_)
+        required_(other.required_),
+        constraints_(other.constraints_),
+        full_name_(other.full_name_),
+        full_hash_(other.full_hash_),
+        full_src_name_(other.full_src_name_),
+        full_src_group_(other.full_src_group_)
     {}
 
     //! assignment operator
@@ -68,8 +91,49 @@ public:
         description_ = other.description_;
         default_ = other.default_;
         required_ = other.required_;
+        constraints_ = other.constraints_;
+        full_name_ = other.full_name_;
+        full_hash_ = other.full_hash_;
+        full_src_name_ = other.full_src_name_;
+        full_src_group_ = other.full_src_group_;
+        return *this;
+    }
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! move constructor
+    ///
+    OneOpt (OneOpt && other) :
+        name_(std::move (other.name_)),
+        group_(std::move (other.group_)),
+        description_(std::move (other.description_)),
+        default_(std::move (other.default_)),
+        required_(other.required_),
+        constraints_(std::move (other.constraints_)),
+        full_name_(std::move (other.full_name_)),
+        full_hash_(other.full_hash_),
+        full_src_name_(std::move (other.full_src_name_)),
+        full_src_group_(std::move (other.full_src_group_))
+    {
+        other.full_hash_ = OptTable::hashKey (other.full_name_);
+    }
+
+    //! move assignment operator
+    ///
+    OneOpt& operator=( OneOpt && other ) {
+        name_ = std::move (other.name_);
+        group_ = std::move (other.group_);
+        description_ = std::move (other.description_);
+        default_ = std::move (other.default_);
+        required_ = other.required_;
+        constraints_ = std::move (other.constraints_);
+        full_name_ = std::move (other.full_name_);
+        full_hash_ = other.full_hash_;
+        full_src_name_ = std::move (other.full_src_name_);
+        full_src_group_ = std::move (other.full_src_group_);
+        other.full_hash_ = OptTable::hashKey (other.full_name_);
         return *this;
     }
+#endif
 
     //! The name.
     ///
@@ -83,19 +147,31 @@ public:
     inline void
     setName (const QString & value) {
         name_ = value;
+        refresh ();
     }
 
     //! Full name (includes the group)
     inline QString fullName () const {
-        if (group_.isEmpty()) {
-            return name_;
+        if (isCurrent ()) {
+            return full_name_;
         } else {
-            return QString ("%1/%2")
-                    .arg(group_)
-                    .arg(name_);
+            return composeFullName ();
         }
     }
 
+    //! Hash of the full name, as computed by OptTable::hashKey().
+    inline uint fullHash () const {
+        if (isCurrent ()) {
+            return full_hash_;
+        } else {
+            return OptTable::hashKey (composeFullName ());
+        }
+    }
+
+    //! Recompute the full name and its hash.
+    void
+    refresh ();
+
 
     //! The group.
     ///
@@ -109,6 +185,7 @@ public:
     inline void
     setGroup (const QString & value) {
         group_ = value;
+        refresh ();
     }
 
     //! The description.
@@ -153,22 +230,104 @@ public:
         required_ = value;
     }
 
+    //! The acceptable values (see OptValidator).
+    ///
+    inline const OptConstraints &
+    constraints () const {
+        return constraints_;
+    }
+
+    //! Change the acceptable values.
+    ///
+    inline void
+    setConstraints (const OptConstraints & value) {
+        constraints_ = value;
+    }
+
+    //! Each value must be an integer in a range.
+    ///
+    inline OneOpt &
+    setIntRange (qint64 i_min, qint64 i_max) {
+        constraints_.setIntRange (i_min, i_max);
+        return *this;
+    }
+
+    //! Each value must be a number in a range.
+    ///
+    inline OneOpt &
+    setDoubleRange (double d_min, double d_max) {
+        constraints_.setDoubleRange (d_min, d_max);
+        return *this;
+    }
+
+    //! Each value must be one of these strings.
+    ///
+    inline OneOpt &
+    setChoices (const QStringList & choices) {
+        constraints_.setChoices (choices);
+        return *this;
+    }
+
+    //! Each value must match a regular expression entirely.
+    ///
+    inline OneOpt &
+    setPattern (const QString & s_pattern) {
+        constraints_.setPattern (s_pattern);
+        return *this;
+    }
+
+    //! The number of values must be in a range.
+    ///
+    inline OneOpt &
+    setCount (int i_min, int i_max) {
+        constraints_.setCount (i_min, i_max);
+        return *this;
+    }
+
 protected:
 
 
 private:
 
+    //! Were name_ and group_ left unchanged since last refresh()?
+    inline bool
+    isCurrent () const {
+        return (name_.constData () == full_src_name_.constData ()) &&
+                (name_.size () == full_src_name_.size ()) &&
+                (group_.constData () == full_src_group_.constData ()) &&
+                (group_.size () == full_src_group_.size ());
+    }
+
+    //! Build the full name from name_ and group_.
+    QString
+    composeFullName () const;
 
+    QString full_name_; /**< cached result of fullName() */
+    uint full_hash_; /**< cached result of fullHash() */
+    QString full_src_name_; /**< name_ when the cache was computed */
+    QString full_src_group_; /**< group_ when the cache was computed */
 };
 
+//! Options are the same if both the name and the group match.
 inline bool operator== (
         const OneOpt& lhs, const OneOpt& rhs){
-    return lhs.name() == rhs.name(); }
+    return (lhs.name() == rhs.name()) && (lhs.group() == rhs.group()); }
 
 inline bool operator!= (
         const OneOpt& lhs, const OneOpt& rhs){
-    return lhs.name() != rhs.name(); }
-
-inline uint qHash(OneOpt key) { return qHash(key.name())*qHash(key.group()); }
+    return !(lhs == rhs); }
+
+//! Hash of the full name, so it depends on both the group and the name
+//! and on their order; the precomputed hash is used when available.
+inline uint qHash(const OneOpt & key, uint seed = 0) {
+    uint h = key.fullHash() ^ seed;
+    // final avalanche, so that the seed affects all the bits
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
 
 #endif // GUARD_APPOPTS_ONEOPT_H_INCLUDE
@@ -0,0 +1,145 @@
+/**
+ * @file one_opt_indexed_list.cc
+ * @brief Definitions for OneOptIndexedList class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "one_opt_indexed_list.h"
+#include "appopts-private.h"
+
+/**
+ * @class OneOptIndexedList
+ *
+ * OneOptList is a plain list, so finding a definition means a linear
+ * search. This class keeps a list and a hash from the full name of each
+ * definition to its index, so lookups by full name take constant time and
+ * a definition that duplicates an existing one is refused when added.
+ *
+ * The list itself is only exposed as a constant reference (`list()`) that
+ * can be passed to `AppOpts::readMultipleFromCfgs()`; changes go through
+ * this class, so the index is always in sync.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty list.
+ */
+OneOptIndexedList::OneOptIndexedList () :
+    list_(),
+    index_()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param list the definitions to add, in order
+ * @param duplicates receives the full names that were skipped (may be NULL)
+ */
+OneOptIndexedList::OneOptIndexedList (
+        const OneOptList & list, QStringList * duplicates) :
+    list_(),
+    index_()
+{
+    APPOPTS_TRACE_ENTRY;
+    list_.reserve (list.count ());
+    index_.reserve (list.count ());
+    foreach (const OneOpt & opt, list) {
+        if (!append (opt) && (duplicates != NULL)) {
+            duplicates->append (opt.fullName ());
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OneOptIndexedList::~OneOptIndexedList ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param opt the definition
+ * @return false if a definition with the same full name exists; the list
+ *         is not changed in that case
+ */
+bool OneOptIndexedList::append (const OneOpt & opt)
+{
+    QString s_full_name = opt.fullName ();
+    if (index_.contains (s_full_name))
+        return false;
+    index_.insert (s_full_name, list_.count ());
+    list_.QList<OneOpt>::append (opt);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param name The name of the option.
+ * @param stgs_group The name of the group where the option lies in settings file.
+ * @param description Human readable description.
+ * @param default_val Default value.
+ * @return false if a definition with the same full name exists
+ */
+bool OneOptIndexedList::append (
+        const QString & name, const QString & stgs_group,
+        const QString & description, const QStringList & default_val)
+{
+    return append (OneOpt::create (name, stgs_group, description, default_val));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_full_name full name of the option (`group/name`)
+ * @return the definition or NULL; valid until the list changes
+ */
+const OneOpt * OneOptIndexedList::find (const QString & s_full_name) const
+{
+    int i = indexOf (s_full_name);
+    return i == -1 ? NULL : &list_.at (i);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The indices of the definitions that follow the removed one change.
+ *
+ * @param s_full_name full name of the option (`group/name`)
+ * @return false if there was no such definition
+ */
+bool OneOptIndexedList::remove (const QString & s_full_name)
+{
+    int i_removed = indexOf (s_full_name);
+    if (i_removed == -1)
+        return false;
+    list_.removeAt (i_removed);
+    index_.remove (s_full_name);
+    int i_max = list_.count ();
+    for (int i = i_removed; i < i_max; ++i) {
+        index_[list_.at (i).fullName ()] = i;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Removes all definitions.
+ */
+void OneOptIndexedList::clear ()
+{
+    list_.clear ();
+    index_.clear ();
+}
+/* ========================================================================= */
@@ -0,0 +1,103 @@
+/**
+ * @file one_opt_indexed_list.h
+ * @brief Declarations for OneOptIndexedList class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_ONEOPTINDEXEDLIST_H_INCLUDE
+#define GUARD_APPOPTS_ONEOPTINDEXEDLIST_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+#include <appopts/one_opt.h>
+#include <appopts/one_opt_list.h>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+//! A list of option definitions indexed by full name.
+class APPOPTS_EXPORT OneOptIndexedList {
+
+public:
+
+    //! Default constructor.
+    OneOptIndexedList ();
+
+    //! Build from a list; duplicates are skipped.
+    explicit OneOptIndexedList (
+            const OneOptList & list,
+            QStringList * duplicates = NULL);
+
+    //! Destructor.
+    ~OneOptIndexedList ();
+
+    //! Add a definition; false if its full name is already present.
+    bool
+    append (
+            const OneOpt & opt);
+
+    //! Create and add a definition; false if already present.
+    bool
+    append (
+            const QString & name,
+            const QString & stgs_group = OneOpt::defaultGroup (),
+            const QString & description = QString(),
+            const QStringList & default_val = QStringList());
+
+    //! Index of a definition by full name (-1 if not present).
+    inline int
+    indexOf (
+            const QString & s_full_name) const {
+        return index_.value (s_full_name, -1);
+    }
+
+    //! Is there a definition with this full name?
+    inline bool
+    contains (
+            const QString & s_full_name) const {
+        return index_.contains (s_full_name);
+    }
+
+    //! The definition with this full name or NULL.
+    const OneOpt *
+    find (
+            const QString & s_full_name) const;
+
+    //! Remove a definition by full name.
+    bool
+    remove (
+            const QString & s_full_name);
+
+    //! Remove all definitions.
+    void
+    clear ();
+
+    //! Number of definitions.
+    inline int
+    count () const {
+        return list_.count ();
+    }
+
+    //! The definition at an index.
+    inline const OneOpt &
+    at (
+            int i) const {
+        return list_.at (i);
+    }
+
+    //! The definitions in the order in which they were added.
+    inline const OneOptList &
+    list () const {
+        return list_;
+    }
+
+private:
+
+    OneOptList list_; /**< the definitions */
+    QHash<QString,int> index_; /**< index in list_ by full name */
+};
+
+#endif // GUARD_APPOPTS_ONEOPTINDEXEDLIST_H_INCLUDE
@@ -25,13 +25,63 @@
 /**
  * @class OneOptList
  *
- *
+ * Definitions may be added as finished OneOpt instances or be built
+ * in place with `emplace()`, which avoids the temporary instance and its
+ * copy.
  */
 
-
+/* ------------------------------------------------------------------------- */
+/**
+ * @param name The name of the option.
+ * @param stgs_group The name of the group where the option lies in settings file.
+ * @param description Human readable description.
+ * @param default_val Default value.
+ */
 void OneOptList::append (
-        const QString name, const QString stgs_group,
-        const QString description, const QStringList default_val)
+        const QString & name, const QString & stgs_group,
+        const QString & description, const QStringList & default_val)
+{
+    emplace (name, stgs_group, description, default_val);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The list stores a blank definition that is then filled, so the strings
+ * are shared once instead of going through a temporary instance.
+ *
+ * @param name The name of the option.
+ * @param stgs_group The name of the group where the option lies in settings file.
+ * @param description Human readable description.
+ * @param default_val Default value.
+ * @return the new definition; valid until the list changes
+ */
+OneOpt & OneOptList::emplace (
+        const QString & name, const QString & stgs_group,
+        const QString & description, const QStringList & default_val)
+{
+    QList<OneOpt>::append (OneOpt ());
+    OneOpt & result = last ();
+    result.name_ = name;
+    result.group_ = stgs_group;
+    result.description_ = description;
+    result.default_ = default_val;
+    result.refresh ();
+    return result;
+}
+/* ========================================================================= */
+
+#ifdef Q_COMPILER_RVALUE_REFS
+/* ------------------------------------------------------------------------- */
+/**
+ * `opt` is left empty.
+ *
+ * @param opt the definition
+ */
+void OneOptList::append (OneOpt && opt)
 {
-    this->QList<OneOpt>::append (OneOpt::create (name, stgs_group, description, default_val));
+    QList<OneOpt>::append (OneOpt ());
+    last () = std::move (opt);
 }
+/* ========================================================================= */
+#endif
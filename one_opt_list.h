@@ -25,12 +25,30 @@ class APPOPTS_EXPORT OneOptList : public QList<OneOpt> {
 
 public:
 
+    using QList<OneOpt>::append;
+
+    //! Create and add a definition.
+    void
+    append (
+            const QString & name,
+            const QString & stgs_group = OneOpt::defaultGroup (),
+            const QString & description = QString(),
+            const QStringList & default_val = QStringList());
+
+    //! Create a definition in place and return it.
+    OneOpt &
+    emplace (
+            const QString & name,
+            const QString & stgs_group = OneOpt::defaultGroup (),
+            const QString & description = QString(),
+            const QStringList & default_val = QStringList());
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! Add a definition, taking over its content.
     void
     append (
-            const QString name,
-            const QString stgs_group = "general",
-            const QString description = QString(),
-            const QStringList default_val = QStringList());
+            OneOpt && opt);
+#endif
 
 protected:
 
@@ -0,0 +1,515 @@
+/**
+ * @file opt_arena.cc
+ * @brief Definitions for OptArena class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_arena.h"
+#include "opt_table.h"
+#include "appopts-private.h"
+
+#include <string.h>
+
+/**
+ * @class OptArena
+ *
+ * A `QMap<QString,QStringList>` needs a tree node, a string for the key,
+ * a list and a string for each value: several small heap blocks for each
+ * option. OptArena keeps the characters of all keys and values in a single
+ * UTF-16 arena and describes each option with a fixed-size entry that
+ * refers to it:
+ *
+ * - the key is split in group and name; each distinct group is stored
+ *   once and entries only hold its index;
+ * - a single value of at most `InlineCapacity` code units is stored
+ *   inside the entry itself;
+ * - a single longer value is a reference into the arena;
+ * - multiple values are a run of references in a separate array.
+ *
+ * Lookups use the same open-addressing scheme as OptTable; keys are
+ * compared in place, without building strings. Slots are stable.
+ *
+ * Replacing the values of an option appends the new characters to the
+ * arena; the space taken by the old ones is reclaimed by `compact()`,
+ * which also runs automatically when more than half of the arena is unused.
+ * The class is meant for large sets of options that rarely change;
+ * values are returned by copy.
+ */
+
+//! initial number of buckets; must be a power of two
+#define OPTARENA_MIN_CAPACITY 16
+
+//! arenas smaller than this are not compacted automatically
+#define OPTARENA_MIN_COMPACT 4096
+
+//! longest name that fits in Entry::name_len_
+#define OPTARENA_MAX_NAME 0xFFFF
+
+//! Number of buckets for a number of entries (load factor of one half).
+static int bucketsFor (int i_count)
+{
+    int result = OPTARENA_MIN_CAPACITY;
+    while (result < i_count * 2) {
+        result *= 2;
+    }
+    return result;
+}
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty arena.
+ */
+OptArena::OptArena () :
+    arena_(),
+    entries_(),
+    values_(),
+    groups_(),
+    group_index_(),
+    buckets_(),
+    garbage_(0)
+{
+    APPOPTS_TRACE_ENTRY;
+    rehash (OPTARENA_MIN_CAPACITY);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptArena::~OptArena ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param values the content; the keys are full names (`group/name`)
+ */
+void OptArena::assign (const QMap<QString,QStringList> & values)
+{
+    clear ();
+    entries_.reserve (values.count ());
+    rehash (bucketsFor (values.count ()));
+    QMap<QString,QStringList>::const_iterator i = values.constBegin ();
+    QMap<QString,QStringList>::const_iterator endi = values.constEnd ();
+    for (; i != endi; ++i) {
+        insert (i.key (), i.value ());
+    }
+    arena_.squeeze ();
+    values_.squeeze ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param table the table to copy
+ */
+void OptArena::assign (const OptTable & table)
+{
+    clear ();
+    entries_.reserve (table.count ());
+    rehash (bucketsFor (table.count ()));
+    int i_max = table.slotCount ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        const OptTable::Entry & e = table.entry (i_slot);
+        if (e.present_) {
+            insert (e.key_, e.values_);
+        }
+    }
+    arena_.squeeze ();
+    values_.squeeze ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Unlike OptTable, slots are not preserved.
+ */
+void OptArena::clear ()
+{
+    arena_.clear ();
+    entries_.clear ();
+    values_.clear ();
+    groups_.clear ();
+    group_index_.clear ();
+    garbage_ = 0;
+    rehash (OPTARENA_MIN_CAPACITY);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The group is the part of the key before the last `/`. Names are limited
+ * to 65535 code units; a longer name is rejected, as its length would not
+ * fit in the entry.
+ *
+ * @param s_key the full name of the option
+ * @param sl_values the values
+ * @return the slot of the option or -1 if the name is too long
+ */
+int OptArena::insert (const QString & s_key, const QStringList & sl_values)
+{
+    int i_slot = find (s_key);
+    if (i_slot != -1) {
+        Entry & e = entries_[i_slot];
+        if ((e.flags_ & SingleValue) != 0) {
+            garbage_ += e.value_.ref_.len_;
+        } else if ((e.flags_ & MultiValue) != 0) {
+            for (quint32 v = 0; v < e.count_; ++v) {
+                garbage_ += values_.at (e.value_.ref_.off_ + v).len_;
+            }
+        }
+        setEntryValues (e, sl_values);
+        if ((arena_.count () > OPTARENA_MIN_COMPACT) &&
+                (garbage_ * 2 > (quint32)arena_.count ())) {
+            compact ();
+        }
+        return i_slot;
+    }
+
+    int i_sep = s_key.lastIndexOf (QChar('/'));
+    if (s_key.length () - i_sep - 1 > OPTARENA_MAX_NAME) {
+        return -1;
+    }
+
+    Entry e;
+    memset (&e, 0, sizeof(e));
+    e.hash_ = OptTable::hashKey (s_key);
+    QString s_name;
+    if (i_sep == -1) {
+        e.group_ = NoGroup;
+        s_name = s_key;
+    } else {
+        e.group_ = groupIndex (s_key.left (i_sep));
+        s_name = s_key.mid (i_sep + 1);
+    }
+    StrRef name = store (s_name);
+    e.name_off_ = name.off_;
+    e.name_len_ = name.len_;
+    setEntryValues (e, sl_values);
+
+    i_slot = entries_.count ();
+    entries_.append (e);
+    if (entries_.count () * 2 > buckets_.count ()) {
+        rehash (buckets_.count () * 2);
+    } else {
+        int mask = buckets_.count () - 1;
+        int i = e.hash_ & mask;
+        while (buckets_.at (i) != -1) {
+            i = (i + 1) & mask;
+        }
+        buckets_[i] = i_slot;
+    }
+    return i_slot;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key the full name of the option
+ * @return the slot or -1
+ */
+int OptArena::find (const QString & s_key) const
+{
+    uint hash = OptTable::hashKey (s_key);
+    int mask = buckets_.count () - 1;
+    int i = hash & mask;
+    for (;;) {
+        int i_slot = buckets_.at (i);
+        if (i_slot == -1) {
+            return -1;
+        }
+        const Entry & e = entries_.at (i_slot);
+        if ((e.hash_ == hash) && matches (e, s_key)) {
+            return i_slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `insert()` or `find()`
+ * @return the full name
+ */
+QString OptArena::key (int i_slot) const
+{
+    const Entry & e = entries_.at (i_slot);
+    StrRef name;
+    name.off_ = e.name_off_;
+    name.len_ = e.name_len_;
+    if (e.group_ == NoGroup) {
+        return load (name);
+    }
+    const StrRef & grp = groups_.at (e.group_);
+    QString result;
+    result.reserve (grp.len_ + 1 + name.len_);
+    result.append (load (grp));
+    result.append (QChar('/'));
+    result.append (load (name));
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `insert()` or `find()`
+ * @return the group (empty if the key has none)
+ */
+QString OptArena::group (int i_slot) const
+{
+    const Entry & e = entries_.at (i_slot);
+    if (e.group_ == NoGroup) {
+        return QString ();
+    }
+    return load (groups_.at (e.group_));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `insert()` or `find()`
+ * @return number of values
+ */
+int OptArena::valueCount (int i_slot) const
+{
+    return entries_.at (i_slot).count_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `insert()` or `find()`
+ * @param i_index index of the value
+ * @return the value or an empty string if the index is out of range
+ */
+QString OptArena::value (int i_slot, int i_index) const
+{
+    const Entry & e = entries_.at (i_slot);
+    if ((i_index < 0) || ((quint32)i_index >= e.count_))
+        return QString ();
+    if ((e.flags_ & InlineValue) != 0) {
+        return QString::fromUtf16 (e.value_.inline_, e.inline_len_);
+    } else if ((e.flags_ & SingleValue) != 0) {
+        return load (e.value_.ref_);
+    } else {
+        return load (values_.at (e.value_.ref_.off_ + i_index));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `insert()` or `find()`
+ * @return the values
+ */
+QStringList OptArena::values (int i_slot) const
+{
+    QStringList result;
+    int i_max = valueCount (i_slot);
+    result.reserve (i_max);
+    for (int i = 0; i < i_max; ++i) {
+        result.append (value (i_slot, i));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The allocated capacity of the containers is counted; the group index
+ * is estimated (a hash node and a string for each group).
+ *
+ * @return number of bytes
+ */
+qint64 OptArena::bytesUsed () const
+{
+    qint64 result = sizeof(*this);
+    result += (qint64)arena_.capacity () * sizeof(ushort);
+    result += (qint64)entries_.capacity () * sizeof(Entry);
+    result += (qint64)values_.capacity () * sizeof(StrRef);
+    result += (qint64)groups_.capacity () * sizeof(StrRef);
+    result += (qint64)buckets_.capacity () * sizeof(int);
+    QHash<QString,quint32>::const_iterator i = group_index_.constBegin ();
+    QHash<QString,quint32>::const_iterator endi = group_index_.constEnd ();
+    for (; i != endi; ++i) {
+        result += 4 * sizeof(void*) + sizeof(QString) +
+                sizeof(QArrayData) + (i.key ().length () + 1) * sizeof(ushort);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Slots are preserved.
+ */
+void OptArena::compact ()
+{
+    QVector<QString> keys;
+    QVector<QStringList> vals;
+    keys.reserve (entries_.count ());
+    vals.reserve (entries_.count ());
+    int i_max = entries_.count ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        keys.append (key (i_slot));
+        vals.append (values (i_slot));
+    }
+    clear ();
+    entries_.reserve (i_max);
+    rehash (bucketsFor (i_max));
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        insert (keys.at (i_slot), vals.at (i_slot));
+    }
+    arena_.squeeze ();
+    values_.squeeze ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return a map with all options
+ */
+QMap<QString,QStringList> OptArena::toMap () const
+{
+    QMap<QString,QStringList> result;
+    int i_max = entries_.count ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        result.insert (key (i_slot), values (i_slot));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_value the string
+ * @return where it was stored
+ */
+OptArena::StrRef OptArena::store (const QString & s_value)
+{
+    StrRef result;
+    result.off_ = arena_.count ();
+    result.len_ = s_value.length ();
+    arena_.resize (result.off_ + result.len_);
+    if (result.len_ > 0) {
+        memcpy (arena_.data () + result.off_, s_value.utf16 (),
+                result.len_ * sizeof(ushort));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param ref where the string is stored
+ * @return a copy of the string
+ */
+QString OptArena::load (const StrRef & ref) const
+{
+    return QString::fromUtf16 (arena_.constData () + ref.off_, ref.len_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_group the group
+ * @return index in groups_
+ */
+quint32 OptArena::groupIndex (const QString & s_group)
+{
+    QHash<QString,quint32>::const_iterator i = group_index_.constFind (s_group);
+    if (i != group_index_.constEnd ()) {
+        return i.value ();
+    }
+    quint32 result = groups_.count ();
+    groups_.append (store (s_group));
+    group_index_.insert (s_group, result);
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param e the entry
+ * @param s_key the full name
+ * @return true if the entry holds this key
+ */
+bool OptArena::matches (const Entry & e, const QString & s_key) const
+{
+    const ushort * key = s_key.utf16 ();
+    quint32 key_len = s_key.length ();
+    if (e.group_ == NoGroup) {
+        return (key_len == e.name_len_) &&
+                (memcmp (key, arena_.constData () + e.name_off_,
+                         key_len * sizeof(ushort)) == 0);
+    }
+    const StrRef & grp = groups_.at (e.group_);
+    if (key_len != grp.len_ + 1 + e.name_len_)
+        return false;
+    if (key[grp.len_] != '/')
+        return false;
+    return (memcmp (key, arena_.constData () + grp.off_,
+                    grp.len_ * sizeof(ushort)) == 0) &&
+            (memcmp (key + grp.len_ + 1, arena_.constData () + e.name_off_,
+                     e.name_len_ * sizeof(ushort)) == 0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param e the entry to change
+ * @param sl_values the values
+ */
+void OptArena::setEntryValues (Entry & e, const QStringList & sl_values)
+{
+    e.count_ = sl_values.count ();
+    e.inline_len_ = 0;
+    if (sl_values.isEmpty ()) {
+        e.flags_ = 0;
+    } else if (sl_values.count () == 1) {
+        const QString & s_value = sl_values.at (0);
+        if (s_value.length () <= InlineCapacity) {
+            e.flags_ = InlineValue;
+            e.inline_len_ = s_value.length ();
+            memcpy (e.value_.inline_, s_value.utf16 (),
+                    s_value.length () * sizeof(ushort));
+        } else {
+            e.flags_ = SingleValue;
+            e.value_.ref_ = store (s_value);
+        }
+    } else {
+        e.flags_ = MultiValue;
+        e.value_.ref_.off_ = values_.count ();
+        e.value_.ref_.len_ = sl_values.count ();
+        foreach (const QString & s_value, sl_values) {
+            values_.append (store (s_value));
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_capacity new number of buckets; must be a power of two
+ */
+void OptArena::rehash (int i_capacity)
+{
+    buckets_.fill (-1, i_capacity);
+    int mask = i_capacity - 1;
+    int i_max = entries_.count ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        int i = entries_.at (i_slot).hash_ & mask;
+        while (buckets_.at (i) != -1) {
+            i = (i + 1) & mask;
+        }
+        buckets_[i] = i_slot;
+    }
+}
+/* ========================================================================= */
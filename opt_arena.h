@@ -0,0 +1,196 @@
+/**
+ * @file opt_arena.h
+ * @brief Declarations for OptArena class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTARENA_H_INCLUDE
+#define GUARD_APPOPTS_OPTARENA_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class OptTable;
+
+//! Compact storage for options, with all strings in a single arena.
+class APPOPTS_EXPORT OptArena {
+
+public:
+
+    //! How the values of an entry are stored.
+    enum EntryFlags {
+        InlineValue = 0x01, /**< single short value inside the entry */
+        SingleValue = 0x02, /**< single value in the arena */
+        MultiValue = 0x04 /**< value references in values_ */
+    };
+
+    //! Number of UTF-16 code units that fit inside an entry.
+    enum {
+        InlineCapacity = 4
+    };
+
+    //! Default constructor.
+    OptArena ();
+
+    //! Destructor.
+    ~OptArena ();
+
+    //! Build from a map of full names to values.
+    void
+    assign (
+            const QMap<QString,QStringList> & values);
+
+    //! Build from the options that hold a value in a table.
+    void
+    assign (
+            const OptTable & table);
+
+    //! Remove all options and release the memory.
+    void
+    clear ();
+
+    //! Insert an option or replace its values; returns its slot or -1.
+    int
+    insert (
+            const QString & s_key,
+            const QStringList & sl_values);
+
+    //! Locate an option (-1 if not present).
+    int
+    find (
+            const QString & s_key) const;
+
+    //! Is the option present?
+    inline bool
+    contains (
+            const QString & s_key) const {
+        return find (s_key) != -1;
+    }
+
+    //! Number of options.
+    inline int
+    count () const {
+        return entries_.count ();
+    }
+
+    //! The full name of the option in a slot.
+    QString
+    key (
+            int i_slot) const;
+
+    //! The group of the option in a slot.
+    QString
+    group (
+            int i_slot) const;
+
+    //! Number of values of the option in a slot.
+    int
+    valueCount (
+            int i_slot) const;
+
+    //! One value of the option in a slot.
+    QString
+    value (
+            int i_slot,
+            int i_index = 0) const;
+
+    //! All values of the option in a slot.
+    QStringList
+    values (
+            int i_slot) const;
+
+    //! Number of distinct groups.
+    inline int
+    groupCount () const {
+        return groups_.count ();
+    }
+
+    //! Bytes used by the arena, entries, value references and indices.
+    qint64
+    bytesUsed () const;
+
+    //! Rebuild the arena without the space left by replaced values.
+    void
+    compact ();
+
+    //! Expanded copy of the content.
+    QMap<QString,QStringList>
+    toMap () const;
+
+private:
+
+    //! A reference to a string in the arena.
+    struct StrRef {
+        quint32 off_; /**< offset in code units */
+        quint32 len_; /**< length in code units */
+    };
+
+    //! One option.
+    struct Entry {
+        quint32 hash_; /**< hash of the full name */
+        quint32 group_; /**< index in groups_ or NoGroup */
+        quint32 name_off_; /**< offset of the name in the arena */
+        quint16 name_len_; /**< length of the name */
+        quint8 flags_; /**< one of EntryFlags (0 for no values) */
+        quint8 inline_len_; /**< length of an inline value */
+        quint32 count_; /**< number of values */
+        union {
+            ushort inline_[InlineCapacity]; /**< InlineValue */
+            StrRef ref_; /**< SingleValue: the string; MultiValue:
+                              off_ is the first index in values_ */
+        } value_;
+    };
+
+    //! Marks entries without a group.
+    static const quint32 NoGroup = 0xFFFFFFFFu;
+
+    //! Append a string to the arena.
+    StrRef
+    store (
+            const QString & s_value);
+
+    //! Read a string from the arena.
+    QString
+    load (
+            const StrRef & ref) const;
+
+    //! The index of a group, added if new.
+    quint32
+    groupIndex (
+            const QString & s_group);
+
+    //! Does the entry hold this key?
+    bool
+    matches (
+            const Entry & e,
+            const QString & s_key) const;
+
+    //! Set the values of an entry.
+    void
+    setEntryValues (
+            Entry & e,
+            const QStringList & sl_values);
+
+    //! Rebuild the buckets with given capacity (power of two).
+    void
+    rehash (
+            int i_capacity);
+
+    QVector<ushort> arena_; /**< all strings, UTF-16 */
+    QVector<Entry> entries_; /**< the options */
+    QVector<StrRef> values_; /**< values of multi-value entries */
+    QVector<StrRef> groups_; /**< distinct groups */
+    QHash<QString,quint32> group_index_; /**< index in groups_ by name */
+    QVector<int> buckets_; /**< open-addressing index into entries_ */
+    quint32 garbage_; /**< code units no longer referenced */
+};
+
+#endif // GUARD_APPOPTS_OPTARENA_H_INCLUDE
@@ -0,0 +1,529 @@
+/**
+ * @file opt_bincache.cc
+ * @brief Definitions for OptBinCache class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_bincache.h"
+#include "opt_table.h"
+#include "appopts-private.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QPair>
+#include <QSaveFile>
+#include <QVector>
+
+#include <algorithm>
+#include <string.h>
+
+/**
+ * @class OptBinCache
+ *
+ * Parsing a config file is a visible part of the startup time. The values
+ * that were looked up in a file (and the keys that were not found in it)
+ * can be saved in a compact binary file next to the source; later runs
+ * map that file in memory and use it instead of parsing the source.
+ *
+ * The cache is only used if the modification time, the size and the
+ * SHA-1 of the source match the ones recorded in the cache. The layout is:
+ *
+ * - a header;
+ * - an array of entries sorted by key hash (binary searched);
+ * - an array of value references;
+ * - a pool of UTF-16 code units holding keys and values.
+ *
+ * Each entry also holds the integer, double and Boolean conversions of its
+ * first value, so these do not need to be computed again. The file uses
+ * native byte order and the hash function of the Qt version that wrote it;
+ * both are recorded and a mismatch simply makes the cache stale.
+ */
+
+//! Extension of cache files.
+#define OPTBINCACHE_SUFFIX ".appopts-cache"
+
+//! Version of the layout.
+#define OPTBINCACHE_FORMAT 1
+
+//! Used to detect a different byte order.
+#define OPTBINCACHE_ENDIAN 0x01020304
+
+//! Header of the cache file.
+struct OptBinCacheHeader {
+    char magic_[4];
+    quint32 format_;
+    quint32 endian_;
+    quint32 qt_version_;
+    qint64 source_mtime_;
+    qint64 source_size_;
+    char source_sha1_[20];
+    quint32 entry_count_;
+    quint32 value_count_;
+    quint32 pool_size_;
+    quint32 version_off_;
+    quint32 version_len_;
+};
+
+//! An entry in the cache file.
+struct OptBinCacheEntry {
+    quint32 hash_;
+    quint32 key_off_;
+    quint32 key_len_;
+    quint32 flags_;
+    quint32 first_value_;
+    quint32 value_count_;
+    qint64 int_;
+    double dbl_;
+};
+
+//! A value reference in the cache file.
+struct OptBinCacheValue {
+    quint32 off_;
+    quint32 len_;
+};
+
+Q_STATIC_ASSERT(sizeof(OptBinCacheHeader) % 8 == 0);
+Q_STATIC_ASSERT(sizeof(OptBinCacheEntry) % 8 == 0);
+
+//! Flags of an entry in the cache file (low bits are OptTable::TypedFlags).
+enum OptBinCacheFlags {
+    OPTBINCACHE_PRESENT = 0x100,
+    OPTBINCACHE_BOOL_VALUE = 0x200
+};
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty instance.
+ */
+OptBinCache::OptBinCache () :
+    file_(),
+    data_(NULL),
+    size_(0)
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptBinCache::~OptBinCache ()
+{
+    APPOPTS_TRACE_ENTRY;
+    if (data_ != NULL) {
+        file_.unmap (const_cast<uchar*>(data_));
+        data_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The identity should be computed before the file is parsed, so that a
+ * change made while parsing results in a stale cache rather than in a
+ * cache with old values that looks fresh.
+ *
+ * @param s_source the file
+ * @param out receives the identity
+ * @return false if the file can't be read
+ */
+bool OptBinCache::identify (const QString & s_source, Source * out)
+{
+    QFileInfo fi (s_source);
+    if (!fi.exists ())
+        return false;
+    out->mtime_ = fi.lastModified ().toMSecsSinceEpoch ();
+    out->size_ = fi.size ();
+
+    QFile f (s_source);
+    if (!f.open (QIODevice::ReadOnly))
+        return false;
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    if (!hash.addData (&f))
+        return false;
+    out->sha1_ = hash.result ();
+    return out->sha1_.size () == 20;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_source path of the config file
+ * @return path of the cache file
+ */
+QString OptBinCache::cachePath (const QString & s_source)
+{
+    return s_source + OPTBINCACHE_SUFFIX;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The cache is rejected if it is missing, malformed, written by a different
+ * Qt version or byte order or if it does not match the source.
+ *
+ * @param s_source path of the config file
+ * @param source identity of the config file, from `identify()`
+ * @return the cache or NULL
+ */
+OptBinCache * OptBinCache::open (
+        const QString & s_source, const Source & source)
+{
+    APPOPTS_TRACE_ENTRY;
+    OptBinCache * result = new OptBinCache ();
+    bool b_ret = false;
+    for (;;) {
+        result->file_.setFileName (cachePath (s_source));
+        if (!result->file_.open (QIODevice::ReadOnly))
+            break;
+        result->size_ = result->file_.size ();
+        if (result->size_ < (qint64)sizeof(OptBinCacheHeader))
+            break;
+        result->data_ = result->file_.map (0, result->size_);
+        if (result->data_ == NULL)
+            break;
+
+        const OptBinCacheHeader * hdr =
+                reinterpret_cast<const OptBinCacheHeader*>(result->data_);
+        if ((memcmp (hdr->magic_, "AOBC", 4) != 0) ||
+                (hdr->format_ != OPTBINCACHE_FORMAT) ||
+                (hdr->endian_ != OPTBINCACHE_ENDIAN) ||
+                (hdr->qt_version_ != QT_VERSION))
+            break;
+
+        qint64 expected = sizeof(OptBinCacheHeader) +
+                (qint64)hdr->entry_count_ * sizeof(OptBinCacheEntry) +
+                (qint64)hdr->value_count_ * sizeof(OptBinCacheValue) +
+                (qint64)hdr->pool_size_ * sizeof(ushort);
+        if (expected != result->size_)
+            break;
+        if ((qint64)hdr->version_off_ + hdr->version_len_ > hdr->pool_size_)
+            break;
+
+        if ((source.sha1_.size () != 20) ||
+                (source.mtime_ != hdr->source_mtime_) ||
+                (source.size_ != hdr->source_size_) ||
+                (memcmp (source.sha1_.constData (), hdr->source_sha1_, 20) != 0))
+            break;
+
+        b_ret = true;
+        break;
+    }
+    if (!b_ret) {
+        delete result;
+        result = NULL;
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The file is written to a temporary file that replaces the old cache
+ * when complete, so a reader never sees a partial cache.
+ *
+ * @param s_source path of the config file
+ * @param source identity of the config file when the values were read
+ * @param s_version the version string of the config file
+ * @param records what is known about the keys
+ * @param s_error receives a description of the error (may be NULL)
+ * @return true if the cache was written
+ */
+bool OptBinCache::write (
+        const QString & s_source, const Source & source,
+        const QString & s_version, const QHash<QString,Record> & records,
+        QString * s_error)
+{
+    APPOPTS_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+        if (source.sha1_.size () != 20) {
+            if (s_error != NULL)
+                *s_error = QCoreApplication::translate (
+                            "AppOpts", "The source file can't be read.");
+            break;
+        }
+
+        // order the keys by hash, then by key
+        QVector< QPair<uint, QString> > order;
+        order.reserve (records.count ());
+        QHash<QString,Record>::const_iterator i = records.constBegin ();
+        QHash<QString,Record>::const_iterator endi = records.constEnd ();
+        for (; i != endi; ++i) {
+            order.append (qMakePair (OptTable::hashKey (i.key ()), i.key ()));
+        }
+        std::sort (order.begin (), order.end ());
+
+        // build the arrays
+        QVector<ushort> pool;
+        QVector<OptBinCacheEntry> entries;
+        QVector<OptBinCacheValue> values;
+        entries.reserve (order.count ());
+
+        OptBinCacheHeader hdr;
+        memset (&hdr, 0, sizeof(hdr));
+        memcpy (hdr.magic_, "AOBC", 4);
+        hdr.format_ = OPTBINCACHE_FORMAT;
+        hdr.endian_ = OPTBINCACHE_ENDIAN;
+        hdr.qt_version_ = QT_VERSION;
+        hdr.source_mtime_ = source.mtime_;
+        hdr.source_size_ = source.size_;
+        memcpy (hdr.source_sha1_, source.sha1_.constData (), 20);
+        hdr.version_off_ = pool.count ();
+        hdr.version_len_ = s_version.length ();
+        for (int c = 0; c < s_version.length (); ++c) {
+            pool.append (s_version.at (c).unicode ());
+        }
+
+        for (int k = 0; k < order.count (); ++k) {
+            const QString & s_key = order.at (k).second;
+            const Record & rec = records[s_key];
+
+            OptBinCacheEntry e;
+            memset (&e, 0, sizeof(e));
+            e.hash_ = order.at (k).first;
+            e.key_off_ = pool.count ();
+            e.key_len_ = s_key.length ();
+            for (int c = 0; c < s_key.length (); ++c) {
+                pool.append (s_key.at (c).unicode ());
+            }
+            e.first_value_ = values.count ();
+            if (rec.present_) {
+                Record typed = presentRecord (rec.values_);
+                e.flags_ = OPTBINCACHE_PRESENT | typed.typed_ |
+                        (typed.bool_ ? OPTBINCACHE_BOOL_VALUE : 0);
+                e.int_ = typed.int_;
+                e.dbl_ = typed.dbl_;
+                e.value_count_ = rec.values_.count ();
+                foreach (const QString & s_value, rec.values_) {
+                    OptBinCacheValue v;
+                    v.off_ = pool.count ();
+                    v.len_ = s_value.length ();
+                    for (int c = 0; c < s_value.length (); ++c) {
+                        pool.append (s_value.at (c).unicode ());
+                    }
+                    values.append (v);
+                }
+            }
+            entries.append (e);
+        }
+        hdr.entry_count_ = entries.count ();
+        hdr.value_count_ = values.count ();
+        hdr.pool_size_ = pool.count ();
+
+        QSaveFile f (cachePath (s_source));
+        if (!f.open (QIODevice::WriteOnly)) {
+            if (s_error != NULL)
+                *s_error = f.errorString ();
+            break;
+        }
+        f.write (reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        f.write (reinterpret_cast<const char*>(entries.constData ()),
+                 entries.count () * sizeof(OptBinCacheEntry));
+        f.write (reinterpret_cast<const char*>(values.constData ()),
+                 values.count () * sizeof(OptBinCacheValue));
+        f.write (reinterpret_cast<const char*>(pool.constData ()),
+                 pool.count () * sizeof(ushort));
+        if (!f.commit ()) {
+            if (s_error != NULL)
+                *s_error = f.errorString ();
+            break;
+        }
+
+        b_ret = true;
+        break;
+    }
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The conversions follow the rules used by AppOpts getters.
+ *
+ * @param sl_values the values
+ * @return the record
+ */
+OptBinCache::Record OptBinCache::presentRecord (const QStringList & sl_values)
+{
+    Record result;
+    result.present_ = true;
+    result.values_ = sl_values;
+    result.typed_ = 0;
+    result.int_ = 0;
+    result.dbl_ = 0.0;
+    result.bool_ = false;
+    if (!sl_values.isEmpty ()) {
+        result.typed_ = OptTable::convertValue (
+                    sl_values.at (0), &result.int_,
+                    &result.dbl_, &result.bool_);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the record
+ */
+OptBinCache::Record OptBinCache::absentRecord ()
+{
+    Record result;
+    result.present_ = false;
+    result.typed_ = 0;
+    result.int_ = 0;
+    result.dbl_ = 0.0;
+    result.bool_ = false;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the `perst_version` of the source file
+ */
+QString OptBinCache::version () const
+{
+    const OptBinCacheHeader * hdr =
+            reinterpret_cast<const OptBinCacheHeader*>(data_);
+    return poolString (hdr->version_off_, hdr->version_len_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return number of keys (present or absent)
+ */
+int OptBinCache::count () const
+{
+    return reinterpret_cast<const OptBinCacheHeader*>(data_)->entry_count_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The entries are binary searched by hash; keys are only compared for
+ * entries with the same hash.
+ *
+ * @param s_key full name of the option
+ * @param out receives the record
+ * @return false if the key is not in the cache (nothing is known about it)
+ */
+bool OptBinCache::lookup (const QString & s_key, Record * out) const
+{
+    const OptBinCacheHeader * hdr =
+            reinterpret_cast<const OptBinCacheHeader*>(data_);
+    const OptBinCacheEntry * entries =
+            reinterpret_cast<const OptBinCacheEntry*>(data_ + sizeof(*hdr));
+    const ushort * pool = reinterpret_cast<const ushort*>(
+                data_ + sizeof(*hdr) +
+                hdr->entry_count_ * sizeof(OptBinCacheEntry) +
+                hdr->value_count_ * sizeof(OptBinCacheValue));
+
+    uint hash = OptTable::hashKey (s_key);
+    int lo = 0;
+    int hi = hdr->entry_count_;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (entries[mid].hash_ < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (int i = lo; (i < (int)hdr->entry_count_) && (entries[i].hash_ == hash); ++i) {
+        const OptBinCacheEntry & e = entries[i];
+        if ((e.key_len_ == (quint32)s_key.length ()) &&
+                ((qint64)e.key_off_ + e.key_len_ <= hdr->pool_size_) &&
+                (memcmp (pool + e.key_off_, s_key.utf16 (),
+                         e.key_len_ * sizeof(ushort)) == 0)) {
+            readRecord (i, out);
+            return true;
+        }
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Used to extend an existing cache with new keys.
+ *
+ * @return all records, by key
+ */
+QHash<QString,OptBinCache::Record> OptBinCache::records () const
+{
+    QHash<QString,Record> result;
+    const OptBinCacheHeader * hdr =
+            reinterpret_cast<const OptBinCacheHeader*>(data_);
+    const OptBinCacheEntry * entries =
+            reinterpret_cast<const OptBinCacheEntry*>(data_ + sizeof(*hdr));
+    for (int i = 0; i < (int)hdr->entry_count_; ++i) {
+        Record rec;
+        readRecord (i, &rec);
+        result.insert (poolString (entries[i].key_off_, entries[i].key_len_), rec);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Values are copied out of the mapped memory so that they do not depend
+ * on the lifetime of this instance.
+ *
+ * @param i index of the entry
+ * @param out receives the record
+ */
+void OptBinCache::readRecord (int i, Record * out) const
+{
+    const OptBinCacheHeader * hdr =
+            reinterpret_cast<const OptBinCacheHeader*>(data_);
+    const OptBinCacheEntry & e =
+            reinterpret_cast<const OptBinCacheEntry*>(data_ + sizeof(*hdr))[i];
+    const OptBinCacheValue * values = reinterpret_cast<const OptBinCacheValue*>(
+                data_ + sizeof(*hdr) +
+                hdr->entry_count_ * sizeof(OptBinCacheEntry));
+
+    out->present_ = (e.flags_ & OPTBINCACHE_PRESENT) != 0;
+    out->typed_ = e.flags_ & 0xFF;
+    out->int_ = e.int_;
+    out->dbl_ = e.dbl_;
+    out->bool_ = (e.flags_ & OPTBINCACHE_BOOL_VALUE) != 0;
+    out->values_.clear ();
+    if ((qint64)e.first_value_ + e.value_count_ > hdr->value_count_) {
+        out->present_ = false;
+        return;
+    }
+    for (quint32 v = 0; v < e.value_count_; ++v) {
+        const OptBinCacheValue & val = values[e.first_value_ + v];
+        out->values_.append (poolString (val.off_, val.len_));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param off offset in code units
+ * @param len length in code units
+ * @return the string (empty if out of bounds)
+ */
+QString OptBinCache::poolString (quint32 off, quint32 len) const
+{
+    const OptBinCacheHeader * hdr =
+            reinterpret_cast<const OptBinCacheHeader*>(data_);
+    if ((qint64)off + len > hdr->pool_size_)
+        return QString ();
+    const ushort * pool = reinterpret_cast<const ushort*>(
+                data_ + sizeof(*hdr) +
+                hdr->entry_count_ * sizeof(OptBinCacheEntry) +
+                hdr->value_count_ * sizeof(OptBinCacheValue));
+    return QString::fromUtf16 (pool + off, len);
+}
+/* ========================================================================= */
@@ -0,0 +1,127 @@
+/**
+ * @file opt_bincache.h
+ * @brief Declarations for OptBinCache class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTBINCACHE_H_INCLUDE
+#define GUARD_APPOPTS_OPTBINCACHE_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+//! Memory-mapped binary cache of the values read from a config file.
+class APPOPTS_EXPORT OptBinCache {
+
+public:
+
+    //! What is known about one key.
+    struct Record {
+        bool present_; /**< is the key present in the source file? */
+        QStringList values_; /**< the values, if present */
+        int typed_; /**< OptTable::TypedFlags for the first value */
+        qint64 int_; /**< first value as integer */
+        double dbl_; /**< first value as double */
+        bool bool_; /**< first value as Boolean */
+    };
+
+    //! Identity of a source file.
+    struct Source {
+        qint64 mtime_; /**< modification time, ms since epoch */
+        qint64 size_; /**< size in bytes */
+        QByteArray sha1_; /**< hash of the content */
+    };
+
+    //! Destructor.
+    ~OptBinCache ();
+
+    //! Compute the identity of a source file.
+    static bool
+    identify (
+            const QString & s_source,
+            Source * out);
+
+    //! Path of the cache for a source file.
+    static QString
+    cachePath (
+            const QString & s_source);
+
+    //! Map the cache of a source file if it is fresh.
+    static OptBinCache *
+    open (
+            const QString & s_source,
+            const Source & source);
+
+    //! Write the cache for a source file.
+    static bool
+    write (
+            const QString & s_source,
+            const Source & source,
+            const QString & s_version,
+            const QHash<QString,Record> & records,
+            QString * s_error = NULL);
+
+    //! Create a record for a present key, with typed values computed.
+    static Record
+    presentRecord (
+            const QStringList & sl_values);
+
+    //! Create a record for an absent key.
+    static Record
+    absentRecord ();
+
+    //! The version string of the source file.
+    QString
+    version () const;
+
+    //! Number of keys in the cache.
+    int
+    count () const;
+
+    //! Look up a key; false if the cache knows nothing about it.
+    bool
+    lookup (
+            const QString & s_key,
+            Record * out) const;
+
+    //! All the records in the cache.
+    QHash<QString,Record>
+    records () const;
+
+private:
+
+    //! Constructor used by open().
+    OptBinCache ();
+
+    //! Reads a record at an index.
+    void
+    readRecord (
+            int i,
+            Record * out) const;
+
+    //! A string from the pool.
+    QString
+    poolString (
+            quint32 off,
+            quint32 len) const;
+
+    //! not copyable
+    OptBinCache (const OptBinCache &);
+
+    //! not assignable
+    OptBinCache& operator=( const OptBinCache& );
+
+    QFile file_; /**< the cache file */
+    const uchar * data_; /**< mapped content */
+    qint64 size_; /**< size of mapped content */
+};
+
+#endif // GUARD_APPOPTS_OPTBINCACHE_H_INCLUDE
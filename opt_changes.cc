@@ -0,0 +1,423 @@
+/**
+ * @file opt_changes.cc
+ * @brief Definitions for OptChanges class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_changes.h"
+#include "opt_table.h"
+#include "appopts-private.h"
+
+/**
+ * @class OptChanges
+ *
+ * The instance is created by the first `AppOpts::subscribe()` and lives
+ * in the thread of its owner. Before an option changes its owner calls
+ * `record()`; the value is remembered only if some listener is
+ * interested in the option and only the first time the option changes
+ * in a transaction (a batch of AppOpts). When the transaction ends
+ * `flush()` reads the new values from the table, drops the options that
+ * ended up with the value they started with and hands each listener a
+ * single list with the changes it subscribed to.
+ *
+ * Listeners subscribed with `QueuedDelivery` are informed from the event
+ * loop instead. Changes that arrive before the loop gets to run are
+ * merged: an option that changes several times appears once, with the
+ * oldest and the newest values, and disappears if it changed back.
+ *
+ * A listener may unsubscribe itself or other listeners while it is being
+ * informed; listeners that were unsubscribed are skipped for the rest of
+ * the delivery, so they may be deleted right after `unsubscribe()`.
+ *
+ * A group subscription covers all options whose full name starts with
+ * the group and a `/`, including those in nested groups; an empty group
+ * covers all options.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key full name of an option
+ * @return the empty group and each group that contains the option,
+ *         outermost first
+ */
+static QStringList groupsOf (const QString & s_key)
+{
+    QStringList result;
+    result.append (QString ());
+    int i = s_key.indexOf (QChar('/'));
+    while (i != -1) {
+        result.append (s_key.left (i));
+        i = s_key.indexOf (QChar('/'), i + 1);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param change the change
+ * @return true if the value before and after are the same
+ */
+static bool isNoChange (const OptChange & change)
+{
+    return (change.had_old_ == change.has_new_) &&
+            (change.old_ == change.new_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an instance without subscriptions.
+ */
+OptChanges::OptChanges () :
+    QObject (),
+    by_key_(),
+    by_group_(),
+    pending_(),
+    pending_index_(),
+    queue_order_(),
+    queued_(),
+    delivering_(0),
+    removed_(),
+    timer_()
+{
+    APPOPTS_TRACE_ENTRY;
+    timer_.setSingleShot (true);
+    timer_.setInterval (0);
+    TimeoutSink sink;
+    sink.changes_ = this;
+    QObject::connect (&timer_, &QTimer::timeout, this, sink);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Queued changes that were not delivered are lost.
+ */
+OptChanges::~OptChanges ()
+{
+    APPOPTS_TRACE_ENTRY;
+    timer_.stop ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Subscribing the same listener twice for the same option changes
+ * the delivery of the existing subscription. A listener that unsubscribed
+ * while changes were being delivered is informed again from now on.
+ *
+ * @param s_key full name of the option
+ * @param listener the object to inform; must be unsubscribed before
+ *        it goes away
+ * @param delivery when to inform the listener
+ */
+void OptChanges::subscribe (
+        const QString & s_key, OptChangeListener * listener,
+        Delivery delivery)
+{
+    removed_.remove (listener);
+    QList<Subscriber> & subs = by_key_[s_key];
+    for (int i = 0; i < subs.count (); ++i) {
+        if (subs.at (i).listener_ == listener) {
+            subs[i].delivery_ = delivery;
+            return;
+        }
+    }
+    Subscriber sub;
+    sub.listener_ = listener;
+    sub.delivery_ = delivery;
+    subs.append (sub);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `subscribe()`.
+ *
+ * @param s_group the group, without the trailing `/`; empty for all options
+ * @param listener the object to inform; must be unsubscribed before
+ *        it goes away
+ * @param delivery when to inform the listener
+ */
+void OptChanges::subscribeGroup (
+        const QString & s_group, OptChangeListener * listener,
+        Delivery delivery)
+{
+    removed_.remove (listener);
+    QList<Subscriber> & subs = by_group_[s_group];
+    for (int i = 0; i < subs.count (); ++i) {
+        if (subs.at (i).listener_ == listener) {
+            subs[i].delivery_ = delivery;
+            return;
+        }
+    }
+    Subscriber sub;
+    sub.listener_ = listener;
+    sub.delivery_ = delivery;
+    subs.append (sub);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Queued changes for the listener are dropped. If changes are being
+ * delivered the listener is not informed by that delivery either.
+ *
+ * @param listener the object that no longer wants to be informed
+ */
+void OptChanges::unsubscribe (OptChangeListener * listener)
+{
+    QHash<QString,QList<Subscriber> > * maps[2] = { &by_key_, &by_group_ };
+    for (int m = 0; m < 2; ++m) {
+        QHash<QString,QList<Subscriber> >::iterator i = maps[m]->begin ();
+        while (i != maps[m]->end ()) {
+            QList<Subscriber> & subs = i.value ();
+            for (int k = subs.count () - 1; k >= 0; --k) {
+                if (subs.at (k).listener_ == listener) {
+                    subs.removeAt (k);
+                }
+            }
+            if (subs.isEmpty ()) {
+                i = maps[m]->erase (i);
+            } else {
+                ++i;
+            }
+        }
+    }
+    queue_order_.removeAll (listener);
+    queued_.remove (listener);
+    if (delivering_ > 0) {
+        removed_.insert (listener);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key full name of the option
+ * @return true if there is a subscription for the option or for a group
+ *         that contains it
+ */
+bool OptChanges::wants (const QString & s_key) const
+{
+    if (by_key_.contains (s_key))
+        return true;
+    if (by_group_.isEmpty ())
+        return false;
+    foreach (const QString & s_group, groupsOf (s_key)) {
+        if (by_group_.contains (s_group))
+            return true;
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only the first call for an option in a transaction has an effect.
+ *
+ * @param s_key full name of the option
+ * @param old_value the value before the change (NULL if it had none)
+ */
+void OptChanges::record (
+        const QString & s_key, const QStringList * old_value)
+{
+    if (pending_index_.contains (s_key))
+        return;
+    if (!wants (s_key))
+        return;
+
+    OptChange change;
+    change.key_ = s_key;
+    change.had_old_ = (old_value != NULL);
+    if (old_value != NULL) {
+        change.old_ = *old_value;
+    }
+    change.has_new_ = false;
+    pending_index_.insert (s_key, pending_.count ());
+    pending_.append (change);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param subs the subscribers of an option or group
+ * @param change the change
+ * @param targets the lists for each listener; a listener that already
+ *        has the change is not given a second copy
+ */
+void OptChanges::collect (
+        const QList<Subscriber> & subs, const OptChange & change,
+        QList<Target> & targets)
+{
+    foreach (const Subscriber & sub, subs) {
+        int t = 0;
+        for (; t < targets.count (); ++t) {
+            if (targets.at (t).listener_ == sub.listener_)
+                break;
+        }
+        if (t == targets.count ()) {
+            Target target;
+            target.listener_ = sub.listener_;
+            target.delivery_ = sub.delivery_;
+            targets.append (target);
+        }
+        QList<OptChange> & changes = targets[t].changes_;
+        if (changes.isEmpty () || (changes.last ().key_ != change.key_)) {
+            changes.append (change);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The recorded changes are cleared before the listeners are informed,
+ * so listeners may change options; those changes are delivered
+ * separately.
+ *
+ * @param table the values at the end of the transaction
+ */
+void OptChanges::flush (const OptTable & table)
+{
+    if (pending_.isEmpty ())
+        return;
+    APPOPTS_TRACE_SPAN("notify", QString::number (pending_.count ()));
+
+    QList<OptChange> pending;
+    pending.swap (pending_);
+    pending_index_.clear ();
+
+    QList<Target> targets;
+    for (int i = 0; i < pending.count (); ++i) {
+        OptChange & change = pending[i];
+        const QStringList * now = table.values (table.find (change.key_));
+        change.has_new_ = (now != NULL);
+        if (now != NULL) {
+            change.new_ = *now;
+        }
+        if (isNoChange (change))
+            continue;
+
+        QHash<QString,QList<Subscriber> >::const_iterator k =
+                by_key_.constFind (change.key_);
+        if (k != by_key_.constEnd ()) {
+            collect (k.value (), change, targets);
+        }
+        if (!by_group_.isEmpty ()) {
+            foreach (const QString & s_group, groupsOf (change.key_)) {
+                QHash<QString,QList<Subscriber> >::const_iterator g =
+                        by_group_.constFind (s_group);
+                if (g != by_group_.constEnd ()) {
+                    collect (g.value (), change, targets);
+                }
+            }
+        }
+    }
+
+    beginDelivery ();
+    foreach (const Target & target, targets) {
+        if (removed_.contains (target.listener_))
+            continue;
+        if (target.delivery_ == QueuedDelivery) {
+            enqueue (target.listener_, target.changes_);
+        } else {
+            target.listener_->optionsChanged (target.changes_);
+        }
+    }
+    endDelivery ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Each option appears once in a listener's queue; the position of an
+ * option is found through an index by full name.
+ *
+ * @param listener the object to inform
+ * @param changes the changes to merge with those already queued
+ */
+void OptChanges::enqueue (
+        OptChangeListener * listener, const QList<OptChange> & changes)
+{
+    QHash<OptChangeListener*,Queue>::iterator q = queued_.find (listener);
+    if (q == queued_.end ()) {
+        queue_order_.append (listener);
+        q = queued_.insert (listener, Queue ());
+    }
+    Queue & merged = q.value ();
+    foreach (const OptChange & change, changes) {
+        QHash<QString,int>::const_iterator i =
+                merged.index_.constFind (change.key_);
+        if (i == merged.index_.constEnd ()) {
+            merged.index_.insert (change.key_, merged.changes_.count ());
+            merged.changes_.append (change);
+        } else {
+            OptChange & known = merged.changes_[i.value ()];
+            known.new_ = change.new_;
+            known.has_new_ = change.has_new_;
+        }
+    }
+    if (!timer_.isActive ()) {
+        timer_.start ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called from the event loop; may also be called directly, for example
+ * before the owner goes away.
+ */
+void OptChanges::deliverQueued ()
+{
+    timer_.stop ();
+    QList<OptChangeListener*> order;
+    order.swap (queue_order_);
+    QHash<OptChangeListener*,Queue> queued;
+    queued.swap (queued_);
+
+    beginDelivery ();
+    foreach (OptChangeListener * listener, order) {
+        if (removed_.contains (listener))
+            continue;
+        QList<OptChange> changes;
+        foreach (const OptChange & change, queued.value (listener).changes_) {
+            if (!isNoChange (change)) {
+                changes.append (change);
+            }
+        }
+        if (!changes.isEmpty ()) {
+            listener->optionsChanged (changes);
+        }
+    }
+    endDelivery ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Deliveries may nest (a listener may change options); the listeners
+ * that were unsubscribed are forgotten when the outermost one ends.
+ */
+void OptChanges::beginDelivery ()
+{
+    ++delivering_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * See `beginDelivery()`.
+ */
+void OptChanges::endDelivery ()
+{
+    if (--delivering_ == 0) {
+        removed_.clear ();
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,183 @@
+/**
+ * @file opt_changes.h
+ * @brief Declarations for OptChanges class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTCHANGES_H_INCLUDE
+#define GUARD_APPOPTS_OPTCHANGES_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class OptTable;
+
+//! The value of an option before and after a change.
+struct OptChange {
+    QString key_; /**< full name of the option */
+    QStringList old_; /**< the value before the change */
+    QStringList new_; /**< the value after the change */
+    bool had_old_; /**< the option had a value before the change */
+    bool has_new_; /**< the option has a value after the change */
+};
+
+//! Interface for objects interested in changed options.
+class APPOPTS_EXPORT OptChangeListener {
+
+public:
+
+    //! Destructor.
+    virtual ~OptChangeListener () {}
+
+    //! The values of some options changed.
+    virtual void
+    optionsChanged (
+            const QList<OptChange> & changes) = 0;
+};
+
+//! Collects the changes of an AppOpts instance and informs subscribers.
+class APPOPTS_EXPORT OptChanges : public QObject {
+
+public:
+
+    //! How the changes reach a listener.
+    enum Delivery {
+        SyncDelivery = 0, /**< when the change (or transaction) ends */
+        QueuedDelivery /**< on next event loop pass, coalesced */
+    };
+
+    //! Constructor.
+    OptChanges ();
+
+    //! Destructor.
+    virtual ~OptChanges ();
+
+    //! Inform a listener about changes of an option.
+    void
+    subscribe (
+            const QString & s_key,
+            OptChangeListener * listener,
+            Delivery delivery = SyncDelivery);
+
+    //! Inform a listener about changes of all options in a group.
+    void
+    subscribeGroup (
+            const QString & s_group,
+            OptChangeListener * listener,
+            Delivery delivery = SyncDelivery);
+
+    //! Remove all subscriptions of a listener.
+    void
+    unsubscribe (
+            OptChangeListener * listener);
+
+    //! Are there no subscriptions?
+    inline bool
+    isEmpty () const {
+        return by_key_.isEmpty () && by_group_.isEmpty ();
+    }
+
+    //! Is some listener interested in an option?
+    bool
+    wants (
+            const QString & s_key) const;
+
+    //! An option is about to change; remember its value.
+    void
+    record (
+            const QString & s_key,
+            const QStringList * old_value);
+
+    //! Are there recorded changes that were not delivered?
+    inline bool
+    hasPending () const {
+        return !pending_.isEmpty ();
+    }
+
+    //! Deliver the recorded changes using the values in a table.
+    void
+    flush (
+            const OptTable & table);
+
+    //! Deliver queued changes now.
+    void
+    deliverQueued ();
+
+private:
+
+    //! A listener and the way it wants the changes.
+    struct Subscriber {
+        OptChangeListener * listener_; /**< the object to inform */
+        Delivery delivery_; /**< when to inform it */
+    };
+
+    //! Changes for one listener.
+    struct Target {
+        OptChangeListener * listener_; /**< the object to inform */
+        Delivery delivery_; /**< when to inform it */
+        QList<OptChange> changes_; /**< what changed */
+    };
+
+    //! Add the subscribers of an entry to the targets of a change.
+    static void
+    collect (
+            const QList<Subscriber> & subs,
+            const OptChange & change,
+            QList<Target> & targets);
+
+    //! Changes waiting for one listener.
+    struct Queue {
+        QList<OptChange> changes_; /**< one entry for each option */
+        QHash<QString,int> index_; /**< index in changes_ by full name */
+    };
+
+    //! Add changes for a listener to the queue.
+    void
+    enqueue (
+            OptChangeListener * listener,
+            const QList<OptChange> & changes);
+
+    //! Listeners are about to be informed.
+    void
+    beginDelivery ();
+
+    //! Listeners were informed.
+    void
+    endDelivery ();
+
+    //! Connects the timer signal to deliverQueued().
+    struct TimeoutSink {
+        OptChanges * changes_;
+        void operator() () const {
+            changes_->deliverQueued ();
+        }
+    };
+
+    //! not copyable
+    OptChanges (const OptChanges &);
+
+    //! not assignable
+    OptChanges& operator=( const OptChanges& );
+
+    QHash<QString,QList<Subscriber> > by_key_; /**< subscribers by full name */
+    QHash<QString,QList<Subscriber> > by_group_; /**< subscribers by group */
+    QList<OptChange> pending_; /**< recorded in current transaction */
+    QHash<QString,int> pending_index_; /**< index in pending_ by full name */
+    QList<OptChangeListener*> queue_order_; /**< listeners with queued changes */
+    QHash<OptChangeListener*,Queue> queued_; /**< waiting for timer_ */
+    int delivering_; /**< nesting level of deliveries in progress */
+    QSet<OptChangeListener*> removed_; /**< unsubscribed while delivering */
+    QTimer timer_; /**< delivers the queued changes */
+};
+
+#endif // GUARD_APPOPTS_OPTCHANGES_H_INCLUDE
@@ -0,0 +1,124 @@
+/**
+ * @file opt_constraints.h
+ * @brief Declarations for OptConstraints class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTCONSTRAINTS_H_INCLUDE
+#define GUARD_APPOPTS_OPTCONSTRAINTS_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QString>
+#include <QStringList>
+
+//! The values that are acceptable for an option.
+///
+/// This is only a description; see OptValidator for the checks.
+class OptConstraints {
+
+public:
+
+    //! The checks that are enabled.
+    enum Check {
+        NoCheck = 0x00, /**< any value is accepted */
+        IntRangeCheck = 0x01, /**< each value is an integer in a range */
+        DoubleRangeCheck = 0x02, /**< each value is a number in a range */
+        ChoicesCheck = 0x04, /**< each value is one of a set of strings */
+        PatternCheck = 0x08, /**< each value matches a regular expression */
+        CountCheck = 0x10 /**< the number of values is in a range */
+    };
+
+    int checks_; /**< combination of Check values */
+    qint64 int_min_; /**< smallest integer for IntRangeCheck */
+    qint64 int_max_; /**< largest integer for IntRangeCheck */
+    double double_min_; /**< smallest number for DoubleRangeCheck */
+    double double_max_; /**< largest number for DoubleRangeCheck */
+    QStringList choices_; /**< acceptable strings for ChoicesCheck */
+    QString pattern_; /**< regular expression for PatternCheck */
+    int count_min_; /**< least number of values for CountCheck */
+    int count_max_; /**< most number of values for CountCheck */
+
+    //! Default constructor; nothing is checked.
+    OptConstraints () :
+        checks_(NoCheck),
+        int_min_(0),
+        int_max_(0),
+        double_min_(0.0),
+        double_max_(0.0),
+        choices_(),
+        pattern_(),
+        count_min_(0),
+        count_max_(0)
+    {}
+
+    //! Is nothing checked?
+    inline bool
+    isEmpty () const {
+        return checks_ == NoCheck;
+    }
+
+    //! Is a check enabled?
+    inline bool
+    has (
+            Check check) const {
+        return (checks_ & check) != 0;
+    }
+
+    //! Each value must be an integer between `i_min` and `i_max`.
+    inline void
+    setIntRange (
+            qint64 i_min,
+            qint64 i_max) {
+        int_min_ = i_min;
+        int_max_ = i_max;
+        checks_ |= IntRangeCheck;
+    }
+
+    //! Each value must be a number between `d_min` and `d_max`.
+    inline void
+    setDoubleRange (
+            double d_min,
+            double d_max) {
+        double_min_ = d_min;
+        double_max_ = d_max;
+        checks_ |= DoubleRangeCheck;
+    }
+
+    //! Each value must be one of these strings.
+    inline void
+    setChoices (
+            const QStringList & choices) {
+        choices_ = choices;
+        checks_ |= ChoicesCheck;
+    }
+
+    //! Each value must match this regular expression entirely.
+    inline void
+    setPattern (
+            const QString & s_pattern) {
+        pattern_ = s_pattern;
+        checks_ |= PatternCheck;
+    }
+
+    //! The number of values must be between `i_min` and `i_max`.
+    inline void
+    setCount (
+            int i_min,
+            int i_max) {
+        count_min_ = i_min;
+        count_max_ = i_max;
+        checks_ |= CountCheck;
+    }
+
+    //! Disable all checks.
+    inline void
+    clear () {
+        *this = OptConstraints ();
+    }
+};
+
+#endif // GUARD_APPOPTS_OPTCONSTRAINTS_H_INCLUDE
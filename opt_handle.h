@@ -0,0 +1,61 @@
+/**
+ * @file opt_handle.h
+ * @brief Declarations for OptHandle class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTHANDLE_H_INCLUDE
+#define GUARD_APPOPTS_OPTHANDLE_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+//! A resolved option name.
+///
+/// Handles are obtained from `AppOpts::handle()` and are only meaningful
+/// for the instance that created them. They stay valid for the lifetime
+/// of that instance.
+class APPOPTS_EXPORT OptHandle {
+
+public:
+
+    //! Default constructor creates an invalid handle.
+    OptHandle () :
+        slot_(-1)
+    {}
+
+    //! Constructor for a slot.
+    explicit OptHandle (int slot) :
+        slot_(slot)
+    {}
+
+    //! Does this handle refer to a slot?
+    ///
+    inline bool
+    isValid () const {
+        return slot_ >= 0;
+    }
+
+    //! The slot in the table.
+    ///
+    inline int
+    slot () const {
+        return slot_;
+    }
+
+private:
+
+    int slot_; /**< index in the table of the owner */
+};
+
+inline bool operator== (
+        const OptHandle& lhs, const OptHandle& rhs){
+    return lhs.slot() == rhs.slot(); }
+
+inline bool operator!= (
+        const OptHandle& lhs, const OptHandle& rhs){
+    return lhs.slot() != rhs.slot(); }
+
+#endif // GUARD_APPOPTS_OPTHANDLE_H_INCLUDE
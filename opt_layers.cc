@@ -0,0 +1,161 @@
+/**
+ * @file opt_layers.cc
+ * @brief Definitions for OptLayers class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_layers.h"
+#include "appopts-private.h"
+
+/**
+ * @class OptLayers
+ *
+ * Each source of values (defaults, the three configuration files, the
+ * command line and the application itself) has its own table. A lookup
+ * starts with the most specific layer and stops at the first layer that
+ * has the key, so the origin of each value is known and a layer can be
+ * dropped or replaced without touching the others.
+ *
+ * The class is a value type; copies are cheap as the tables
+ * are implicitly shared.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an instance with all layers empty.
+ */
+OptLayers::OptLayers ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptLayers::~OptLayers ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key full name of the option
+ * @param sl_out receives the value, if found (may be NULL)
+ * @param layer receives the layer that provided the value or NoLayer
+ *        (may be NULL)
+ * @return true if any layer has the key
+ */
+bool OptLayers::resolve (
+        const QString & s_key, QStringList * sl_out, int * layer) const
+{
+    for (int i = LayerCount - 1; i >= 0; --i) {
+        QHash<QString,QStringList>::const_iterator found =
+                layers_[i].constFind (s_key);
+        if (found != layers_[i].constEnd ()) {
+            if (sl_out != NULL) {
+                *sl_out = found.value ();
+            }
+            if (layer != NULL) {
+                *layer = i;
+            }
+            return true;
+        }
+    }
+    if (layer != NULL) {
+        *layer = NoLayer;
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key full name of the option
+ * @return the layer or NoLayer
+ */
+int OptLayers::origin (const QString & s_key) const
+{
+    int result = NoLayer;
+    resolve (s_key, NULL, &result);
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param layer one of the Layer values
+ * @param s_key full name of the option
+ * @param sl_value the value
+ */
+void OptLayers::setValue (
+        int layer, const QString & s_key, const QStringList & sl_value)
+{
+    Q_ASSERT((layer >= 0) && (layer < LayerCount));
+    layers_[layer].insert (s_key, sl_value);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param layer one of the Layer values
+ * @param s_key full name of the option
+ */
+void OptLayers::removeValue (int layer, const QString & s_key)
+{
+    Q_ASSERT((layer >= 0) && (layer < LayerCount));
+    layers_[layer].remove (s_key);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Passing an empty table drops the layer.
+ *
+ * @param layer one of the Layer values
+ * @param values new content
+ * @return the keys present in either the old or the new content
+ */
+QSet<QString> OptLayers::replaceLayer (
+        int layer, const QHash<QString,QStringList> & values)
+{
+    Q_ASSERT((layer >= 0) && (layer < LayerCount));
+    QSet<QString> result;
+    QHash<QString,QStringList>::const_iterator i = layers_[layer].constBegin ();
+    QHash<QString,QStringList>::const_iterator endi = layers_[layer].constEnd ();
+    for (; i != endi; ++i) {
+        result.insert (i.key ());
+    }
+    i = values.constBegin ();
+    endi = values.constEnd ();
+    for (; i != endi; ++i) {
+        result.insert (i.key ());
+    }
+    layers_[layer] = values;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param layer one of the Layer values
+ * @return the name or an empty string for invalid values
+ */
+const char * OptLayers::layerName (int layer)
+{
+    switch (layer) {
+    case DefaultLayer: return "default";
+    case SystemLayer: return "system";
+    case UserLayer: return "user";
+    case LocalLayer: return "local";
+    case CommandLineLayer: return "command line";
+    case RuntimeLayer: return "runtime";
+    default: return "";
+    }
+}
+/* ========================================================================= */
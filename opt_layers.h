@@ -0,0 +1,91 @@
+/**
+ * @file opt_layers.h
+ * @brief Declarations for OptLayers class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTLAYERS_H_INCLUDE
+#define GUARD_APPOPTS_OPTLAYERS_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+//! Option values kept separately for each source.
+class APPOPTS_EXPORT OptLayers {
+
+public:
+
+    //! The sources of values; higher values take precedence.
+    enum Layer {
+        NoLayer = -1, /**< the value was not found */
+        DefaultLayer = 0, /**< defaults from option definitions */
+        SystemLayer, /**< the file in system data directory */
+        UserLayer, /**< the file in user home directory */
+        LocalLayer, /**< the file in current directory */
+        CommandLineLayer, /**< command line and environment */
+        RuntimeLayer, /**< values set by the application */
+        LayerCount /**< number of layers */
+    };
+
+    //! Default constructor.
+    OptLayers ();
+
+    //! Destructor.
+    ~OptLayers ();
+
+    //! Find the value from the most specific layer that has it.
+    bool
+    resolve (
+            const QString & s_key,
+            QStringList * sl_out,
+            int * layer = NULL) const;
+
+    //! The layer that provides the value of a key (NoLayer if none).
+    int
+    origin (
+            const QString & s_key) const;
+
+    //! Set the value of a key in a layer.
+    void
+    setValue (
+            int layer,
+            const QString & s_key,
+            const QStringList & sl_value);
+
+    //! Remove a key from a layer.
+    void
+    removeValue (
+            int layer,
+            const QString & s_key);
+
+    //! Replace the content of a layer; returns the keys that were affected.
+    QSet<QString>
+    replaceLayer (
+            int layer,
+            const QHash<QString,QStringList> & values);
+
+    //! The content of a layer.
+    inline const QHash<QString,QStringList> &
+    layer (
+            int layer) const {
+        return layers_[layer];
+    }
+
+    //! Human readable name of a layer.
+    static const char *
+    layerName (
+            int layer);
+
+private:
+
+    QHash<QString,QStringList> layers_[LayerCount]; /**< one table per layer */
+};
+
+#endif // GUARD_APPOPTS_OPTLAYERS_H_INCLUDE
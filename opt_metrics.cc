@@ -0,0 +1,239 @@
+/**
+ * @file opt_metrics.cc
+ * @brief Definitions for OptMetrics class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_metrics.h"
+#include "opt_table.h"
+#include "appopts-private.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QStringList>
+
+/**
+ * @class OptMetrics
+ *
+ * Counters are plain atomic integers updated with relaxed ordering, so
+ * any number of threads may count reads without locking. They are grouped
+ * in chunks of consecutive table slots; a chunk is allocated the first time
+ * one of its slots is counted and published with a compare-and-swap.
+ * Because table slots are never reused, the counters of a slot always
+ * belong to the same key.
+ *
+ * Lookups by name for keys that were never inserted have no slot; they are
+ * counted together and the names are remembered (up to a limit) under
+ * a lock, which is only taken on that path.
+ *
+ * Counters are 32 bits wide and wrap around.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an instance with all counters zero.
+ */
+OptMetrics::OptMetrics () :
+    names_lock_(),
+    unknown_names_()
+{
+    APPOPTS_TRACE_ENTRY;
+    for (int i = 0; i < MaxChunks; ++i) {
+        chunks_[i].store (NULL);
+    }
+    for (int i = 0; i < CounterCount; ++i) {
+        unknown_[i].store (0);
+        untracked_[i].store (0);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptMetrics::~OptMetrics ()
+{
+    APPOPTS_TRACE_ENTRY;
+    for (int i = 0; i < MaxChunks; ++i) {
+        delete chunks_[i].loadAcquire ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot table slot or -1
+ * @param counter which counter to increment
+ */
+void OptMetrics::add (int i_slot, Counter counter)
+{
+    if (i_slot < 0) {
+        unknown_[counter].fetchAndAddRelaxed (1);
+    } else {
+        this->counter (i_slot, counter).fetchAndAddRelaxed (1);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name the name that was not found
+ */
+void OptMetrics::addUnknownName (const QString & s_name)
+{
+    QMutexLocker lock (&names_lock_);
+    if (unknown_names_.count () < MaxUnknownNames) {
+        unknown_names_.insert (s_name);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot table slot or -1
+ * @param counter which counter to read
+ * @return the value
+ */
+uint OptMetrics::value (int i_slot, Counter counter) const
+{
+    if (i_slot < 0) {
+        return static_cast<uint>(unknown_[counter].load ());
+    }
+    const QAtomicInt * c = counterIfAny (i_slot, counter);
+    return c == NULL ? 0 : static_cast<uint>(c->load ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Counting may continue in other threads; increments that race with
+ * the reset may or may not survive it.
+ */
+void OptMetrics::reset ()
+{
+    for (int i = 0; i < MaxChunks; ++i) {
+        Chunk * chunk = chunks_[i].loadAcquire ();
+        if (chunk == NULL)
+            continue;
+        for (int j = 0; j < ChunkSize * CounterCount; ++j) {
+            chunk->counters_[j].store (0);
+        }
+    }
+    for (int i = 0; i < CounterCount; ++i) {
+        unknown_[i].store (0);
+        untracked_[i].store (0);
+    }
+    QMutexLocker lock (&names_lock_);
+    unknown_names_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The result is an object with:
+ * - `options`: one object for each slot in the table, with the `key`,
+ *   whether it is `present` and the `reads`, `misses`, `defaults` and
+ *   `parse_failures` counters;
+ * - `unknown`: the same counters for names that are not in the table,
+ *   and the `names` that were seen;
+ * - `untracked`: the counters for slots past the capacity of the
+ *   directory (normally all zero).
+ *
+ * Keys that were never read have `reads` equal to zero.
+ *
+ * @param table the table whose slots were counted
+ * @return indented JSON
+ */
+QByteArray OptMetrics::toJson (const OptTable & table) const
+{
+    static const char * const names[CounterCount] = {
+        "reads", "misses", "defaults", "parse_failures"
+    };
+
+    QJsonArray options;
+    int i_max = table.slotCount ();
+    for (int i = 0; i < i_max; ++i) {
+        const OptTable::Entry & e = table.entry (i);
+        QJsonObject opt;
+        opt.insert ("key", e.key_);
+        opt.insert ("present", e.present_);
+        for (int c = 0; c < CounterCount; ++c) {
+            opt.insert (names[c], static_cast<double>(
+                            value (i, static_cast<Counter>(c))));
+        }
+        options.append (opt);
+    }
+
+    QJsonObject unknown;
+    QJsonObject untracked;
+    for (int c = 0; c < CounterCount; ++c) {
+        unknown.insert (names[c], static_cast<double>(
+                            static_cast<uint>(unknown_[c].load ())));
+        untracked.insert (names[c], static_cast<double>(
+                              static_cast<uint>(untracked_[c].load ())));
+    }
+    {
+        QMutexLocker lock (&names_lock_);
+        QStringList sl_names = unknown_names_.values ();
+        sl_names.sort ();
+        unknown.insert ("names", QJsonArray::fromStringList (sl_names));
+    }
+
+    QJsonObject root;
+    root.insert ("options", options);
+    root.insert ("unknown", unknown);
+    root.insert ("untracked", untracked);
+    return QJsonDocument (root).toJson (QJsonDocument::Indented);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot table slot (not negative)
+ * @param counter which counter
+ * @return the counter
+ */
+QAtomicInt & OptMetrics::counter (int i_slot, Counter counter)
+{
+    int i_chunk = i_slot / ChunkSize;
+    if (i_chunk >= MaxChunks) {
+        return untracked_[counter];
+    }
+    Chunk * chunk = chunks_[i_chunk].loadAcquire ();
+    if (chunk == NULL) {
+        Chunk * fresh = new Chunk ();
+        if (chunks_[i_chunk].testAndSetOrdered (NULL, fresh)) {
+            chunk = fresh;
+        } else {
+            delete fresh;
+            chunk = chunks_[i_chunk].loadAcquire ();
+        }
+    }
+    return chunk->counters_[(i_slot % ChunkSize) * CounterCount + counter];
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot table slot (not negative)
+ * @param counter which counter
+ * @return the counter or NULL if its chunk was never created
+ */
+const QAtomicInt * OptMetrics::counterIfAny (int i_slot, Counter counter) const
+{
+    int i_chunk = i_slot / ChunkSize;
+    if (i_chunk >= MaxChunks) {
+        return &untracked_[counter];
+    }
+    const Chunk * chunk = chunks_[i_chunk].loadAcquire ();
+    if (chunk == NULL)
+        return NULL;
+    return &chunk->counters_[(i_slot % ChunkSize) * CounterCount + counter];
+}
+/* ========================================================================= */
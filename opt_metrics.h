@@ -0,0 +1,105 @@
+/**
+ * @file opt_metrics.h
+ * @brief Declarations for OptMetrics class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTMETRICS_H_INCLUDE
+#define GUARD_APPOPTS_OPTMETRICS_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+class OptTable;
+
+//! Counters for the reads of options, by table slot.
+class APPOPTS_EXPORT OptMetrics {
+
+public:
+
+    //! The counters kept for each slot.
+    enum Counter {
+        Reads = 0, /**< calls to a getter */
+        Misses, /**< the option had no value */
+        Defaults, /**< the default value was returned */
+        ParseFailures, /**< the value could not be converted */
+        CounterCount /**< number of counters */
+    };
+
+    //! Default constructor.
+    OptMetrics ();
+
+    //! Destructor.
+    ~OptMetrics ();
+
+    //! Increment a counter for a slot (-1 for names that are not known).
+    void
+    add (
+            int i_slot,
+            Counter counter);
+
+    //! Remember a name that was looked up but is not known.
+    void
+    addUnknownName (
+            const QString & s_name);
+
+    //! The value of a counter for a slot (-1 for names that are not known).
+    uint
+    value (
+            int i_slot,
+            Counter counter) const;
+
+    //! Set all counters to zero and forget unknown names.
+    void
+    reset ();
+
+    //! Machine-readable dump of all counters.
+    QByteArray
+    toJson (
+            const OptTable & table) const;
+
+private:
+
+    //! Slots covered by a chunk.
+    enum { ChunkSize = 1024 };
+
+    //! Chunks in the directory; slots past the end are counted together.
+    enum { MaxChunks = 4096 };
+
+    //! Most unknown names that are remembered.
+    enum { MaxUnknownNames = 1024 };
+
+    //! Counters for ChunkSize consecutive slots.
+    struct Chunk {
+        QAtomicInt counters_[ChunkSize * CounterCount]; /**< by slot, then counter */
+    };
+
+    //! The counter for a slot and kind; chunks are created on demand.
+    QAtomicInt &
+    counter (
+            int i_slot,
+            Counter counter);
+
+    //! The counter for a slot and kind or NULL if never incremented.
+    const QAtomicInt *
+    counterIfAny (
+            int i_slot,
+            Counter counter) const;
+
+    QAtomicPointer<Chunk> chunks_[MaxChunks]; /**< chunks; NULL until used */
+    QAtomicInt unknown_[CounterCount]; /**< lookups of names not in the table */
+    QAtomicInt untracked_[CounterCount]; /**< slots past the last chunk */
+    mutable QMutex names_lock_; /**< protects unknown_names_ */
+    QSet<QString> unknown_names_; /**< names looked up but not known */
+};
+
+#endif // GUARD_APPOPTS_OPTMETRICS_H_INCLUDE
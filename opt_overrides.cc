@@ -0,0 +1,202 @@
+/**
+ * @file opt_overrides.cc
+ * @brief Definitions for OptOverrides class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_overrides.h"
+#include "appopts.h"
+#include "appopts-private.h"
+
+#include <QCoreApplication>
+
+/**
+ * @class OptOverrides
+ *
+ * The schema is turned into two hash tables when the instance is created:
+ * full names and environment variable names. Arguments and environment
+ * entries are then scanned once, each with a single lookup, and the
+ * values are collected in a hash that becomes the command line layer
+ * of AppOpts in one step (see `AppOpts::loadOverrides()`).
+ *
+ * Arguments have the form `--group/name=value`; `--group/name` alone
+ * means `true`. An option given more than once collects all the values.
+ * Everything after `--` and all arguments that do not start with `--`
+ * are positional. The first argument is the program and is skipped.
+ *
+ * Environment variables are named `APPNAME_GROUP_NAME` (see `envName()`).
+ * Arguments take precedence over the environment, whatever the order
+ * in which the two were parsed.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_input part of the name of a variable
+ * @return upper-case text with non-alphanumeric characters replaced
+ */
+static QString envPart (const QString & s_input)
+{
+    QString result = s_input.toUpper ();
+    for (int i = 0; i < result.length (); ++i) {
+        if (!result.at (i).isLetterOrNumber ()) {
+            result[i] = QChar('_');
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * When two options map to the same environment variable the first one
+ * in the schema wins.
+ *
+ * @param schema the options that may be overridden
+ * @param s_app_name name of the application used for environment
+ *        variables; the name of the running application if empty
+ */
+OptOverrides::OptOverrides (
+        const OneOptList & schema, const QString & s_app_name) :
+    names_(),
+    by_env_(),
+    s_env_prefix_(),
+    values_(),
+    from_args_(),
+    unknown_(),
+    positional_()
+{
+    APPOPTS_TRACE_ENTRY;
+    QString s_app = s_app_name.isEmpty () ?
+                QCoreApplication::applicationName () : s_app_name;
+    s_env_prefix_ = envPart (AppOpts::cfgFileName (s_app)) + QChar('_');
+
+    names_.reserve (schema.count ());
+    by_env_.reserve (schema.count ());
+    foreach (const OneOpt & opt, schema) {
+        QString s_full = opt.fullName ();
+        names_.insert (s_full);
+        QString s_env = envName (s_app, opt);
+        if (!by_env_.contains (s_env)) {
+            by_env_.insert (s_env, s_full);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptOverrides::~OptOverrides ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param args the arguments, starting with the program
+ * @return false if some options are not in the schema (see `unknown()`)
+ */
+bool OptOverrides::parseArguments (const QStringList & args)
+{
+    APPOPTS_TRACE_SPAN("parseArguments", QString ());
+    bool b_options = true;
+    for (int i = 1; i < args.count (); ++i) {
+        const QString & s_arg = args.at (i);
+        if (!b_options || !s_arg.startsWith (QLatin1String ("--"))) {
+            positional_.append (s_arg);
+            continue;
+        }
+        if (s_arg.length () == 2) {
+            b_options = false;
+            continue;
+        }
+
+        int i_eq = s_arg.indexOf (QChar('='), 2);
+        QSet<QString>::const_iterator name = names_.constFind (
+                    i_eq == -1 ? s_arg.mid (2) : s_arg.mid (2, i_eq - 2));
+        if (name == names_.constEnd ()) {
+            unknown_.append (s_arg);
+            continue;
+        }
+
+        QString s_value = (i_eq == -1) ?
+                    QString ("true") : s_arg.mid (i_eq + 1);
+        if (from_args_.contains (*name)) {
+            values_[*name].append (s_value);
+        } else {
+            from_args_.insert (*name);
+            values_.insert (*name, QStringList (s_value));
+        }
+    }
+    return unknown_.isEmpty ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Entries for options that were given as arguments are ignored.
+ *
+ * @param env entries in `NAME=value` form, as returned by
+ *        `QProcessEnvironment::toStringList()`
+ */
+void OptOverrides::parseEnvironment (const QStringList & env)
+{
+    APPOPTS_TRACE_SPAN("parseEnvironment", QString ());
+    foreach (const QString & s_entry, env) {
+        if (!s_entry.startsWith (s_env_prefix_))
+            continue;
+        int i_eq = s_entry.indexOf (QChar('='));
+        if (i_eq == -1)
+            continue;
+        QHash<QString,QString>::const_iterator opt =
+                by_env_.constFind (s_entry.left (i_eq));
+        if (opt == by_env_.constEnd ())
+            continue;
+        if (from_args_.contains (opt.value ()))
+            continue;
+        values_.insert (opt.value (), QStringList (s_entry.mid (i_eq + 1)));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The name is `APPNAME_GROUP_NAME` (or `APPNAME_NAME` for options without
+ * a group) in upper case, with all characters that are not letters or
+ * digits replaced by `_`. The application name is first transformed by
+ * `AppOpts::cfgFileName()`.
+ *
+ * @param s_app_name name of the application
+ * @param opt the option
+ * @return the name of the variable
+ */
+QString OptOverrides::envName (const QString & s_app_name, const OneOpt & opt)
+{
+    QString result = envPart (AppOpts::cfgFileName (s_app_name));
+    if (!opt.group ().isEmpty ()) {
+        result.append (QChar('_'));
+        result.append (envPart (opt.group ()));
+    }
+    result.append (QChar('_'));
+    result.append (envPart (opt.name ()));
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The lookup tables built from the schema are kept.
+ */
+void OptOverrides::clear ()
+{
+    values_.clear ();
+    from_args_.clear ();
+    unknown_.clear ();
+    positional_.clear ();
+}
+/* ========================================================================= */
@@ -0,0 +1,83 @@
+/**
+ * @file opt_overrides.h
+ * @brief Declarations for OptOverrides class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTOVERRIDES_H_INCLUDE
+#define GUARD_APPOPTS_OPTOVERRIDES_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+#include <appopts/one_opt_list.h>
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+//! Values for known options taken from the command line and environment.
+class APPOPTS_EXPORT OptOverrides {
+
+public:
+
+    //! Prepare the lookup tables for a schema.
+    explicit OptOverrides (
+            const OneOptList & schema,
+            const QString & s_app_name = QString());
+
+    //! Destructor.
+    ~OptOverrides ();
+
+    //! Take values from `--group/name=value` arguments.
+    bool
+    parseArguments (
+            const QStringList & args);
+
+    //! Take values from `APPNAME_GROUP_NAME=value` entries.
+    void
+    parseEnvironment (
+            const QStringList & env);
+
+    //! The values found so far, by full name.
+    inline const QHash<QString,QStringList> &
+    values () const {
+        return values_;
+    }
+
+    //! Arguments that look like options but are not in the schema.
+    inline const QStringList &
+    unknown () const {
+        return unknown_;
+    }
+
+    //! Arguments that are not options.
+    inline const QStringList &
+    positional () const {
+        return positional_;
+    }
+
+    //! The environment variable that corresponds to an option.
+    static QString
+    envName (
+            const QString & s_app_name,
+            const OneOpt & opt);
+
+    //! Forget the values, unknown and positional arguments.
+    void
+    clear ();
+
+private:
+
+    QSet<QString> names_; /**< full names of the options in the schema */
+    QHash<QString,QString> by_env_; /**< full names by environment variable */
+    QString s_env_prefix_; /**< `APPNAME_`, shared by all variables */
+    QHash<QString,QStringList> values_; /**< results */
+    QSet<QString> from_args_; /**< keys set by arguments */
+    QStringList unknown_; /**< unrecognized options */
+    QStringList positional_; /**< other arguments */
+};
+
+#endif // GUARD_APPOPTS_OPTOVERRIDES_H_INCLUDE
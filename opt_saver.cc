@@ -0,0 +1,611 @@
+/**
+ * @file opt_saver.cc
+ * @brief Definitions for OptSaver class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_saver.h"
+#include "appopts.h"
+#include "appopts-private.h"
+#include "one_opt.h"
+
+#include <perst/perst.h>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QTemporaryFile>
+
+/**
+ * @class OptSaver
+ *
+ * The saver is created by `AppOpts::setWriteBack()` and lives in the
+ * thread of its owner. `setValue()`, `appendValue()` and `appendValues()`
+ * mark the option as dirty and (re)start a timer; when no change arrived
+ * for `delay()` milliseconds the values that the application set for the
+ * dirty options (the runtime layer, see OptLayers) are collected and
+ * written to the current file of the owner in a single batch. Values
+ * that come from the defaults, the other files or the command line are
+ * not written. A burst of changes thus results in a single write.
+ *
+ * Only the lines of the dirty options change (see `patchIni()`): comments,
+ * blank lines and the other keys are kept as they are. The result is read
+ * back through PerSt before it is used, so a value that would not be read
+ * as it was written is reported instead of being saved, and it replaces
+ * the original file in a single rename, so a reader sees either the old
+ * or the new file, never a partial one.
+ *
+ * The content of each file that was written is remembered, so that the
+ * watcher of the owner (see `AppOpts::setHotReload()`) does not reload a
+ * file because of our own write (see `isOwnWrite()`).
+ *
+ * In asynchronous mode (the default) the write happens in a worker
+ * thread; writes are performed one at a time, in the order in which the
+ * batches were collected. The timer needs an event loop in the thread of
+ * the owner; without one use `flush()` (or `AppOpts::saveChanges()`).
+ */
+
+//! Writes a batch in the worker thread.
+class OptSaverJob : public QRunnable {
+
+public:
+
+    OptSaverJob (
+            OptSaver * saver,
+            const OptSaver::Batch & batch) :
+        QRunnable (),
+        saver_(saver),
+        batch_(batch)
+    {}
+
+    virtual void
+    run () {
+        saver_->write (batch_);
+    }
+
+private:
+
+    OptSaver * saver_;
+    OptSaver::Batch batch_;
+};
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param owner the instance to save; must outlive the saver
+ */
+OptSaver::OptSaver (AppOpts * owner) :
+    QObject (),
+    owner_(owner),
+    dirty_(),
+    timer_(),
+    async_(true),
+    pool_(),
+    mutex_(),
+    last_error_(),
+    written_()
+{
+    APPOPTS_TRACE_ENTRY;
+    pool_.setMaxThreadCount (1);
+    timer_.setSingleShot (true);
+    timer_.setInterval (500);
+    TimeoutSink sink;
+    sink.saver_ = this;
+    QObject::connect (&timer_, &QTimer::timeout, this, sink);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Pending changes are written before the saver goes away.
+ */
+OptSaver::~OptSaver ()
+{
+    APPOPTS_TRACE_ENTRY;
+    flush ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_msec the delay in milliseconds; 0 writes on next event loop pass
+ */
+void OptSaver::setDelay (int i_msec)
+{
+    timer_.setInterval (qMax (0, i_msec));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param b_enable true to write in a worker thread, false to write in the
+ *        thread of the owner when the delay expires
+ */
+void OptSaver::setAsync (bool b_enable)
+{
+    async_ = b_enable;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The timer is restarted, so the write happens `delay()` milliseconds
+ * after the last change.
+ *
+ * @param s_key full name of the option
+ */
+void OptSaver::markDirty (const QString & s_key)
+{
+    dirty_.insert (s_key);
+    timer_.start ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same as marking each option, but the timer is restarted only once.
+ *
+ * @param keys full names of the options
+ */
+void OptSaver::markDirty (const QStringList & keys)
+{
+    foreach (const QString & s_key, keys) {
+        dirty_.insert (s_key);
+    }
+    timer_.start ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs in the thread of the owner.
+ */
+void OptSaver::timeout ()
+{
+    Batch batch;
+    if (!collect (batch))
+        return;
+    if (async_) {
+        pool_.start (new OptSaverJob (this, batch));
+    } else {
+        write (batch);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The writes that are already running in the worker thread are waited
+ * for, then the pending changes are written in the calling thread.
+ *
+ * @param s_error receives a description of the error (may be NULL)
+ * @return true if all writes succeeded
+ */
+bool OptSaver::flush (QString * s_error)
+{
+    timer_.stop ();
+    pool_.waitForDone ();
+
+    Batch batch;
+    if (collect (batch)) {
+        write (batch);
+    }
+
+    QString s_last = lastError ();
+    if (s_error != NULL) {
+        *s_error = s_last;
+    }
+    return s_last.isEmpty ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The dirty set is cleared. If the owner has no current file the changes
+ * are dropped and an error is recorded. An option that has no value in
+ * the runtime layer is removed from the file.
+ *
+ * @param batch receives the changes
+ * @return false if there is nothing to write
+ */
+bool OptSaver::collect (Batch & batch)
+{
+    if (dirty_.isEmpty ())
+        return false;
+
+    QString s_file = owner_->currentLocation ();
+    if (s_file.isEmpty ()) {
+        dirty_.clear ();
+        setLastError (QCoreApplication::translate (
+                          "AppOpts", "There is no current file to save to."));
+        return false;
+    }
+
+    batch.file_ = s_file;
+    const QHash<QString,QStringList> & runtime =
+            owner_->layers_.layer (OptLayers::RuntimeLayer);
+    foreach (const QString & s_key, dirty_) {
+        QHash<QString,QStringList>::const_iterator i = runtime.constFind (s_key);
+        if (i == runtime.constEnd ()) {
+            batch.removed_.append (s_key);
+        } else {
+            batch.changed_.insert (s_key, i.value ());
+        }
+    }
+    dirty_.clear ();
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_error the error or an empty string
+ */
+void OptSaver::setLastError (const QString & s_error)
+{
+    QMutexLocker lock (&mutex_);
+    last_error_ = s_error;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the error or an empty string
+ */
+QString OptSaver::lastError () const
+{
+    QMutexLocker lock (&mutex_);
+    return last_error_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs in the worker thread or in the thread of the owner.
+ *
+ * @param batch the changes
+ */
+void OptSaver::write (const Batch & batch)
+{
+    QString s_error;
+    QByteArray content;
+    if (writeBatch (batch, &s_error, &content)) {
+        QMutexLocker lock (&mutex_);
+        written_.insert (batch.file_, QCryptographicHash::hash (
+                             content, QCryptographicHash::Sha1));
+    }
+    setLastError (s_error);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called by the watcher when a file changed on disk. The file is ours
+ * as long as its content is the one we wrote last; once it changes in
+ * some other way it is forgotten.
+ *
+ * @param s_file path of the file
+ * @return true if the file holds what this saver wrote last
+ */
+bool OptSaver::isOwnWrite (const QString & s_file)
+{
+    QByteArray written;
+    {
+        QMutexLocker lock (&mutex_);
+        written = written_.value (s_file);
+    }
+    if (written.isEmpty ())
+        return false;
+
+    QFile f (s_file);
+    if (f.open (QIODevice::ReadOnly)) {
+        if (QCryptographicHash::hash (
+                    f.readAll (), QCryptographicHash::Sha1) == written) {
+            return true;
+        }
+    }
+
+    QMutexLocker lock (&mutex_);
+    if (written_.value (s_file) == written) {
+        written_.remove (s_file);
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The changes are applied to the text of the file by `patchIni()`, so
+ * comments, blank lines and the order of the keys are preserved. The
+ * result is first written to a temporary file that is read back through
+ * PerSt: if any changed option would not be read back with the value that
+ * was written (or a removed one would still be found) the file is left
+ * alone and an error is reported. Otherwise the result replaces the file
+ * atomically. This method does not change any instance and may be used
+ * from any thread.
+ *
+ * A file that no longer exists is created with a `general` section.
+ *
+ * @param batch the changes
+ * @param s_error receives a description of the error
+ * @param out_content receives what was written (may be NULL)
+ * @return true if the file was written
+ */
+bool OptSaver::writeBatch (
+        const Batch & batch, QString * s_error, QByteArray * out_content)
+{
+    APPOPTS_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+        QByteArray original;
+        QFile src (batch.file_);
+        if (src.exists ()) {
+            if (!src.open (QIODevice::ReadOnly)) {
+                *s_error = src.errorString ();
+                break;
+            }
+            original = src.readAll ();
+            if (src.error () != QFile::NoError) {
+                *s_error = src.errorString ();
+                break;
+            }
+            src.close ();
+        } else {
+            original = QByteArray ("[" CFG_GROUP_GENERAL "]\n"
+                                   CFG_PERST_VERSION "="
+                                   APPOPTS_VERSION_STRING "\n");
+        }
+        QByteArray content = patchIni (original, batch);
+
+        // make sure the result reads back as intended
+        QTemporaryFile tmp (QDir::tempPath () + "/appopts-XXXXXX.ini");
+        if (!tmp.open ()) {
+            *s_error = tmp.errorString ();
+            break;
+        }
+        if (!writeAll (tmp, content, s_error))
+            break;
+        tmp.close ();
+        if (!verifyBatch (tmp.fileName (), batch, s_error))
+            break;
+
+        QSaveFile out (batch.file_);
+        if (!out.open (QIODevice::WriteOnly)) {
+            *s_error = out.errorString ();
+            break;
+        }
+        if (!writeAll (out, content, s_error))
+            break;
+        if (!out.commit ()) {
+            *s_error = out.errorString ();
+            break;
+        }
+        if (out_content != NULL) {
+            *out_content = content;
+        }
+
+        s_error->clear ();
+        b_ret = true;
+        break;
+    }
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sections are the groups of the options and keys are their names, the
+ * same layout PerSt reads. In a section that has changes a changed key
+ * is rewritten in place and a removed key is dropped; keys that are new
+ * are added at the end of the section, before its trailing blank lines.
+ * Sections that do not exist are appended to the end of the text. Options
+ * that have no group go before the first section. Every other line,
+ * including comments, is kept as it is, and so are the line endings.
+ *
+ * @param content the text of the file (UTF-8)
+ * @param batch the changes
+ * @return the new text of the file
+ */
+QByteArray OptSaver::patchIni (const QByteArray & content, const Batch & batch)
+{
+    QString s_text = QString::fromUtf8 (content);
+    QString s_eol = s_text.contains (QLatin1String ("\r\n")) ?
+                QString ("\r\n") : QString ("\n");
+    QStringList lines;
+    if (!s_text.isEmpty ()) {
+        lines = s_text.split (s_eol);
+        if (s_text.endsWith (s_eol)) {
+            lines.removeLast ();
+        }
+    }
+    QSet<QString> removed = batch.removed_.toSet ();
+    QSet<QString> done;
+
+    QStringList out;
+    QString s_section;
+    int i_start = 0;
+    foreach (const QString & s_line, lines) {
+        QString s_trim = s_line.trimmed ();
+        if (s_trim.startsWith (QChar('[')) && s_trim.endsWith (QChar(']'))) {
+            addNewKeys (out, i_start, s_section, batch, done);
+            s_section = s_trim.mid (1, s_trim.length () - 2).trimmed ();
+            out.append (s_line);
+            i_start = out.count ();
+            continue;
+        }
+
+        int i_eq = s_line.indexOf (QChar('='));
+        if ((i_eq != -1) &&
+                !s_trim.startsWith (QChar(';')) &&
+                !s_trim.startsWith (QChar('#'))) {
+            QString s_name = s_line.left (i_eq).trimmed ();
+            QString s_key = s_section.isEmpty () ?
+                        s_name : s_section + QChar('/') + s_name;
+            QMap<QString,QStringList>::const_iterator i =
+                    batch.changed_.constFind (s_key);
+            if (i != batch.changed_.constEnd ()) {
+                // a key that appears twice is only written once
+                if (!done.contains (s_key)) {
+                    out.append (s_name + QChar('=') + formatValue (i.value ()));
+                    done.insert (s_key);
+                }
+                continue;
+            }
+            if (removed.contains (s_key)) {
+                continue;
+            }
+        }
+        out.append (s_line);
+    }
+    addNewKeys (out, i_start, s_section, batch, done);
+
+    // groups that had no section
+    QMap<QString,QStringList>::const_iterator i = batch.changed_.constBegin ();
+    QMap<QString,QStringList>::const_iterator endi = batch.changed_.constEnd ();
+    for (; i != endi; ++i) {
+        if (done.contains (i.key ()))
+            continue;
+        int i_sep = i.key ().lastIndexOf (QChar('/'));
+        QString s_group = i.key ().left (qMax (i_sep, 0));
+        if (!out.isEmpty () && !out.last ().trimmed ().isEmpty ()) {
+            out.append (QString ());
+        }
+        out.append (QChar('[') + s_group + QChar(']'));
+        addNewKeys (out, out.count (), s_group, batch, done);
+    }
+
+    return (out.join (s_eol) + s_eol).toUtf8 ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The values are separated by a comma and a space, the form used by the
+ * files that PerSt reads. A value that would not survive this (a value
+ * with a comma, for example) is caught by the check in `writeBatch()`.
+ *
+ * @param sl_value the values of an option
+ * @return the text that goes after the `=`
+ */
+QString OptSaver::formatValue (const QStringList & sl_value)
+{
+    return sl_value.join (QLatin1String (", "));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The lines go after the last line of the section that is not blank.
+ *
+ * @param out the lines of the result
+ * @param i_start index in \b out of the first line of the section
+ * @param s_section the section (empty before the first section)
+ * @param batch the changes
+ * @param done the options that were written; updated
+ */
+void OptSaver::addNewKeys (
+        QStringList & out, int i_start, const QString & s_section,
+        const Batch & batch, QSet<QString> & done)
+{
+    int i_at = out.count ();
+    while ((i_at > i_start) && out.at (i_at - 1).trimmed ().isEmpty ()) {
+        --i_at;
+    }
+    QMap<QString,QStringList>::const_iterator i = batch.changed_.constBegin ();
+    QMap<QString,QStringList>::const_iterator endi = batch.changed_.constEnd ();
+    for (; i != endi; ++i) {
+        if (done.contains (i.key ()))
+            continue;
+        int i_sep = i.key ().lastIndexOf (QChar('/'));
+        if (i.key ().left (qMax (i_sep, 0)) != s_section)
+            continue;
+        out.insert (i_at++, i.key ().mid (i_sep + 1) + QChar('=') +
+                    formatValue (i.value ()));
+        done.insert (i.key ());
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_file the file to check
+ * @param batch the changes that should be visible in it
+ * @param s_error receives a description of the error
+ * @return true if PerSt reads back every change
+ */
+bool OptSaver::verifyBatch (
+        const QString & s_file, const Batch & batch, QString * s_error)
+{
+    QString s_version;
+    QString s_parse_error;
+    PerSt * perst = AppOpts::parseCfgFile (s_file, &s_version, &s_parse_error);
+    if (perst == NULL) {
+        *s_error = QCoreApplication::translate (
+                    "AppOpts", "The changed file could not be read back: %1")
+                .arg (s_parse_error);
+        return false;
+    }
+
+    bool b_ret = true;
+    QStringList keys = batch.changed_.keys () + batch.removed_;
+    foreach (const QString & s_key, keys) {
+        int i_sep = s_key.lastIndexOf (QChar('/'));
+        OneOpt opt = OneOpt::create (
+                    s_key.mid (i_sep + 1), s_key.left (qMax (i_sep, 0)));
+        QStringList sl_read;
+        bool b_found = AppOpts::valueFromPerSt (perst, opt, sl_read);
+
+        QMap<QString,QStringList>::const_iterator i =
+                batch.changed_.constFind (s_key);
+        bool b_same;
+        if (i == batch.changed_.constEnd ()) {
+            b_same = !b_found;
+        } else if (i.value ().isEmpty ()) {
+            // an empty list is written as an empty value
+            b_same = b_found && (sl_read.isEmpty () ||
+                                 (sl_read == QStringList (QString ())));
+        } else {
+            b_same = b_found && (sl_read == i.value ());
+        }
+        if (!b_same) {
+            *s_error = QCoreApplication::translate (
+                        "AppOpts", "Option %1 would not be read back "
+                        "as it was written.").arg (s_key);
+            b_ret = false;
+            break;
+        }
+    }
+    delete perst;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param dev the device to write to
+ * @param content what to write
+ * @param s_error receives a description of the error
+ * @return true if all the bytes were written
+ */
+bool OptSaver::writeAll (
+        QIODevice & dev, const QByteArray & content, QString * s_error)
+{
+    qint64 i_done = 0;
+    while (i_done < content.size ()) {
+        qint64 i_now = dev.write (content.constData () + i_done,
+                                  content.size () - i_done);
+        if (i_now <= 0) {
+            *s_error = dev.errorString ();
+            return false;
+        }
+        i_done += i_now;
+    }
+    return true;
+}
+/* ========================================================================= */
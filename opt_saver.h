@@ -0,0 +1,187 @@
+/**
+ * @file opt_saver.h
+ * @brief Declarations for OptSaver class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTSAVER_H_INCLUDE
+#define GUARD_APPOPTS_OPTSAVER_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QObject>
+#include <QTimer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class AppOpts;
+class QIODevice;
+
+//! Writes changed values back to the current file of an AppOpts instance.
+class APPOPTS_EXPORT OptSaver : public QObject {
+
+public:
+
+    //! The changes to be written to a file.
+    struct Batch {
+        QString file_; /**< path of the file */
+        QMap<QString,QStringList> changed_; /**< new values by full name */
+        QStringList removed_; /**< options that no longer have a value */
+    };
+
+    //! Constructor.
+    explicit OptSaver (
+            AppOpts * owner);
+
+    //! Destructor; pending changes are written.
+    virtual ~OptSaver ();
+
+    //! Time to wait for more changes before writing (milliseconds).
+    inline int
+    delay () const {
+        return timer_.interval ();
+    }
+
+    //! Set the time to wait for more changes before writing.
+    void
+    setDelay (
+            int i_msec);
+
+    //! Are the files written in a worker thread?
+    inline bool
+    async () const {
+        return async_;
+    }
+
+    //! Write the files in a worker thread.
+    void
+    setAsync (
+            bool b_enable);
+
+    //! An option was changed.
+    void
+    markDirty (
+            const QString & s_key);
+
+    //! Several options were changed.
+    void
+    markDirty (
+            const QStringList & keys);
+
+    //! Are there changes that were not written yet?
+    inline bool
+    hasPending () const {
+        return !dirty_.isEmpty ();
+    }
+
+    //! Write pending changes now and wait for all writes to finish.
+    bool
+    flush (
+            QString * s_error = NULL);
+
+    //! The error reported by the last write (empty if it succeeded).
+    QString
+    lastError () const;
+
+    //! Does a file hold what was written last by this saver?
+    bool
+    isOwnWrite (
+            const QString & s_file);
+
+    //! Apply a batch of changes to a file.
+    static bool
+    writeBatch (
+            const Batch & batch,
+            QString * s_error,
+            QByteArray * out_content = NULL);
+
+    //! Apply a batch of changes to the text of a file.
+    static QByteArray
+    patchIni (
+            const QByteArray & content,
+            const Batch & batch);
+
+    //! The text used for the values of an option in a file.
+    static QString
+    formatValue (
+            const QStringList & sl_value);
+
+private:
+
+    //! The delay expired.
+    void
+    timeout ();
+
+    //! Collect the values of the dirty options.
+    bool
+    collect (
+            Batch & batch);
+
+    //! Write a batch and remember the outcome.
+    void
+    write (
+            const Batch & batch);
+
+    //! Remember the outcome of a write.
+    void
+    setLastError (
+            const QString & s_error);
+
+    //! Add the changed options of a section that are not in the file yet.
+    static void
+    addNewKeys (
+            QStringList & out,
+            int i_start,
+            const QString & s_section,
+            const Batch & batch,
+            QSet<QString> & done);
+
+    //! Does a file read back through PerSt hold the changes?
+    static bool
+    verifyBatch (
+            const QString & s_file,
+            const Batch & batch,
+            QString * s_error);
+
+    //! Write all the bytes to a device.
+    static bool
+    writeAll (
+            QIODevice & dev,
+            const QByteArray & content,
+            QString * s_error);
+
+    friend class OptSaverJob;
+
+    //! Connects the timer signal to timeout().
+    struct TimeoutSink {
+        OptSaver * saver_;
+        void operator() () const {
+            saver_->timeout ();
+        }
+    };
+
+    //! not copyable
+    OptSaver (const OptSaver &);
+
+    //! not assignable
+    OptSaver& operator=( const OptSaver& );
+
+    AppOpts * owner_; /**< the instance being saved */
+    QSet<QString> dirty_; /**< options changed since last write */
+    QTimer timer_; /**< delays the writes */
+    bool async_; /**< write in the worker thread */
+    QThreadPool pool_; /**< the worker thread */
+    mutable QMutex mutex_; /**< guards last_error_ and written_ */
+    QString last_error_; /**< outcome of the last write */
+    QHash<QString,QByteArray> written_; /**< SHA-1 of what was written, by path */
+};
+
+#endif // GUARD_APPOPTS_OPTSAVER_H_INCLUDE
@@ -0,0 +1,390 @@
+/**
+ * @file opt_schema.h
+ * @brief Declarations for OptSchema class template
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * Options are declared once, as types, with APPOPTS_OPTION:
+ *
+ *     APPOPTS_OPTION(Verbose, bool, "general", "verbose", false, "Print more");
+ *     APPOPTS_OPTION(Port, int, "network", "port", 8080, "Listening port");
+ *
+ *     typedef OptSchema<Verbose, Port> Schema;
+ *
+ * then a schema instance is loaded from an AppOpts instance and read with
+ * typed getters:
+ *
+ *     Schema schema;
+ *     schema.load (opts, um);
+ *     int port = schema.get<Port> ();
+ *
+ * Because options are named by their type, a misspelled option or one that
+ * is not part of the schema fails to compile. Two options with the same
+ * full name in a schema also fail to compile. `get<>()` is an access to
+ * a member of a tuple at an index computed at compile time; the value was
+ * converted once, by `refresh()`.
+ *
+ * The cached values are a copy: reloads of the files and changes made
+ * through AppOpts are not seen by `get<>()` until `refresh()` is called
+ * again, for example from an OptChangeListener subscribed to the options.
+ *
+ * The facility needs a C++11 compiler; with older compilers this header
+ * declares nothing.
+ */
+
+#ifndef GUARD_APPOPTS_OPTSCHEMA_H_INCLUDE
+#define GUARD_APPOPTS_OPTSCHEMA_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+#include <appopts/appopts.h>
+#include <appopts/opt_handle.h>
+#include <appopts/one_opt_list.h>
+
+#include <QString>
+#include <QStringList>
+
+#if defined(Q_COMPILER_CONSTEXPR) && defined(Q_COMPILER_VARIADIC_TEMPLATES)
+
+#include <tuple>
+
+//! Helpers for OptSchema; not part of the interface.
+namespace OptSchemaDetail {
+
+//! FNV-1a offset basis.
+static const unsigned FnvBasis = 2166136261u;
+
+//! FNV-1a hash of a string, evaluated at compile time.
+constexpr unsigned
+fnv1a (
+        const char * s,
+        unsigned h = FnvBasis) {
+    return (*s == '\0') ? h :
+           fnv1a (s + 1, (h ^ static_cast<unsigned char>(*s)) * 16777619u);
+}
+
+//! Hash of a full name (`group/name`, or `name` if there is no group).
+constexpr unsigned
+fullHash (
+        const char * group,
+        const char * name) {
+    return (*group == '\0') ?
+                fnv1a (name) :
+                fnv1a (name, fnv1a ("/", fnv1a (group)));
+}
+
+//! Length of a string, evaluated at compile time.
+constexpr unsigned
+length (
+        const char * s) {
+    return (*s == '\0') ? 0 : 1 + length (s + 1);
+}
+
+//! Character \b i of a full name; \b glen is the length of the group.
+constexpr char
+fullChar (
+        const char * group,
+        const char * name,
+        unsigned glen,
+        unsigned i) {
+    return (glen == 0) ? name[i] :
+           (i < glen) ? group[i] :
+           (i == glen) ? '/' : name[i - glen - 1];
+}
+
+//! Are two full names the same, starting with character \b i?
+constexpr bool
+sameFrom (
+        const char * g1, const char * n1, unsigned l1,
+        const char * g2, const char * n2, unsigned l2,
+        unsigned i) {
+    return (fullChar (g1, n1, l1, i) != fullChar (g2, n2, l2, i)) ? false :
+           (fullChar (g1, n1, l1, i) == '\0') ? true :
+           sameFrom (g1, n1, l1, g2, n2, l2, i + 1);
+}
+
+//! Are two full names the same (`a` + `b/c` is the same as `a/b` + `c`)?
+constexpr bool
+sameFullName (
+        const char * g1,
+        const char * n1,
+        const char * g2,
+        const char * n2) {
+    return sameFrom (g1, n1, length (g1), g2, n2, length (g2), 0);
+}
+
+//! Is the full name of the first option different from all the others?
+///
+/// The hashes are compared first; the names only if the hashes are equal.
+template <typename First>
+constexpr bool
+differsFromAll (unsigned) {
+    return true;
+}
+
+template <typename First, typename Second, typename... Rest>
+constexpr bool
+differsFromAll (unsigned h) {
+    return ((Second::hash () != h) ||
+            !sameFullName (First::group (), First::name (),
+                           Second::group (), Second::name ())) &&
+            differsFromAll<First, Rest...> (h);
+}
+
+//! Are the full names of all options distinct?
+template <typename... Opts>
+struct Distinct;
+
+template <>
+struct Distinct<> {
+    static constexpr bool value = true;
+};
+
+template <typename First, typename... Rest>
+struct Distinct<First, Rest...> {
+    static constexpr bool value =
+            differsFromAll<First, Rest...> (First::hash ()) &&
+            Distinct<Rest...>::value;
+};
+
+//! Position of an option in a list of options (-1 if not present).
+template <int I, typename Opt, typename... Opts>
+struct IndexOf;
+
+template <int I, typename Opt>
+struct IndexOf<I, Opt> {
+    static constexpr int value = -1;
+};
+
+template <int I, typename Opt, typename... Rest>
+struct IndexOf<I, Opt, Opt, Rest...> {
+    static constexpr int value = I;
+};
+
+template <int I, typename Opt, typename First, typename... Rest>
+struct IndexOf<I, Opt, First, Rest...> {
+    static constexpr int value = IndexOf<I + 1, Opt, Rest...>::value;
+};
+
+//! A sequence of indices.
+template <int... I>
+struct Seq {};
+
+//! Builds Seq<0, 1, ..., N - 1>.
+template <int N, int... I>
+struct MakeSeq : MakeSeq<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeSeq<0, I...> {
+    typedef Seq<I...> Type;
+};
+
+//! Used to expand a parameter pack for its side effects.
+inline void
+expand (std::initializer_list<int>) {}
+
+} // namespace OptSchemaDetail
+
+//! How values of a type are read from AppOpts and written as strings.
+template <typename T>
+struct OptSchemaType;
+
+template <>
+struct OptSchemaType<bool> {
+    static bool read (const AppOpts & opts, OptHandle h, bool d) {
+        return opts.valueB (h, d);
+    }
+    static QStringList toStrings (bool v) {
+        return QStringList (QString (v ? "true" : "false"));
+    }
+};
+
+template <>
+struct OptSchemaType<int> {
+    static int read (const AppOpts & opts, OptHandle h, int d) {
+        return opts.valueI (h, d);
+    }
+    static QStringList toStrings (int v) {
+        return QStringList (QString::number (v));
+    }
+};
+
+template <>
+struct OptSchemaType<double> {
+    static double read (const AppOpts & opts, OptHandle h, double d) {
+        return opts.valueD (h, d);
+    }
+    static QStringList toStrings (double v) {
+        return QStringList (QString::number (v, 'g', 17));
+    }
+};
+
+template <>
+struct OptSchemaType<QString> {
+    static QString read (const AppOpts & opts, OptHandle h, const QString & d) {
+        return opts.valueS (h, d);
+    }
+    static QStringList toStrings (const QString & v) {
+        return QStringList (v);
+    }
+};
+
+template <>
+struct OptSchemaType<QStringList> {
+    static QStringList read (const AppOpts & opts, OptHandle h, const QStringList & d) {
+        return opts.valueSL (h, d);
+    }
+    static QStringList toStrings (const QStringList & v) {
+        return v;
+    }
+};
+
+//! Declares an option as a type that can be used with OptSchema.
+#define APPOPTS_OPTION(tag, type, group_lit, name_lit, default_val, desc_lit) \
+    struct tag { \
+        typedef type Type; \
+        static constexpr const char * group () { return group_lit; } \
+        static constexpr const char * name () { return name_lit; } \
+        static constexpr const char * description () { return desc_lit; } \
+        static constexpr unsigned hash () { \
+            return OptSchemaDetail::fullHash (group_lit, name_lit); \
+        } \
+        static Type defaultValue () { return default_val; } \
+    }
+
+//! A set of options known at compile time, with typed cached values.
+template <typename... Opts>
+class OptSchema {
+
+    static_assert (OptSchemaDetail::Distinct<Opts...>::value,
+                   "two options in the schema have the same full name");
+
+public:
+
+    //! Number of options in the schema.
+    static constexpr int Count = sizeof...(Opts);
+
+    //! The slot of an option; fails to compile if it is not in the schema.
+    template <typename Opt>
+    static constexpr int
+    slot () {
+        static_assert (OptSchemaDetail::IndexOf<0, Opt, Opts...>::value != -1,
+                       "the option is not part of this schema");
+        return OptSchemaDetail::IndexOf<0, Opt, Opts...>::value;
+    }
+
+    //! Constructor; all values are the defaults.
+    OptSchema () :
+        values_(Opts::defaultValue ()...),
+        handles_()
+    {}
+
+    //! The definitions, to be used with `AppOpts::readMultipleFromCfgs()`.
+    static OneOptList
+    toOneOptList () {
+        OneOptList result;
+        OptSchemaDetail::expand ({
+            (result.append (QString (Opts::name ()),
+                            QString (Opts::group ()),
+                            QString (Opts::description ()),
+                            OptSchemaType<typename Opts::Type>::toStrings (
+                                Opts::defaultValue ())), 0)... });
+        return result;
+    }
+
+    //! Read the options from the files, then bind and refresh.
+    bool
+    load (
+            AppOpts & opts,
+            UserMsg & um) {
+        bool b_ret = opts.readMultipleFromCfgs (toOneOptList (), um);
+        bind (opts);
+        refresh (opts);
+        return b_ret;
+    }
+
+    //! Resolve the handles of the options in an AppOpts instance.
+    void
+    bind (
+            AppOpts & opts) {
+        bindAll (opts, typename OptSchemaDetail::MakeSeq<Count>::Type ());
+    }
+
+    //! Convert and cache the current values; `bind()` must be called first.
+    void
+    refresh (
+            const AppOpts & opts) {
+        refreshAll (opts, typename OptSchemaDetail::MakeSeq<Count>::Type ());
+    }
+
+    //! The cached value of an option, as of last `refresh()` or `set()`.
+    template <typename Opt>
+    inline const typename Opt::Type &
+    get () const {
+        return std::get<slot<Opt> ()> (values_);
+    }
+
+    //! Change an option in AppOpts and, unless it is only staged, in the cache.
+    ///
+    /// Inside a transaction of \b opts the change is staged, so the cache
+    /// keeps the current value; call `refresh()` after the commit.
+    template <typename Opt>
+    void
+    set (
+            AppOpts & opts,
+            const typename Opt::Type & value) {
+        opts.setValue (
+                    fullName<Opt> (),
+                    OptSchemaType<typename Opt::Type>::toStrings (value));
+        if (!opts.inTransaction ()) {
+            std::get<slot<Opt> ()> (values_) = value;
+        }
+    }
+
+    //! The full name of an option (`group/name` or `name`); built once.
+    template <typename Opt>
+    static const QString &
+    fullName () {
+        static const QString s_name = (*Opt::group () == '\0') ?
+                    QString (Opt::name ()) :
+                    QString (Opt::group ()) + QChar('/') + QString (Opt::name ());
+        return s_name;
+    }
+
+    //! The handle of an option, valid after `bind()`.
+    template <typename Opt>
+    inline OptHandle
+    handle () const {
+        return handles_[slot<Opt> ()];
+    }
+
+private:
+
+    template <int... I>
+    void
+    bindAll (
+            AppOpts & opts,
+            OptSchemaDetail::Seq<I...>) {
+        OneOptList defs = toOneOptList ();
+        OptSchemaDetail::expand ({ (handles_[I] = opts.handle (defs.at (I)), 0)... });
+    }
+
+    template <int... I>
+    void
+    refreshAll (
+            const AppOpts & opts,
+            OptSchemaDetail::Seq<I...>) {
+        OptSchemaDetail::expand ({
+            (std::get<I> (values_) =
+                OptSchemaType<typename Opts::Type>::read (
+                    opts, handles_[I], Opts::defaultValue ()), 0)... });
+    }
+
+    std::tuple<typename Opts::Type...> values_; /**< converted values */
+    OptHandle handles_[Count == 0 ? 1 : Count]; /**< slots in AppOpts */
+};
+
+#endif // Q_COMPILER_CONSTEXPR && Q_COMPILER_VARIADIC_TEMPLATES
+
+#endif // GUARD_APPOPTS_OPTSCHEMA_H_INCLUDE
@@ -0,0 +1,289 @@
+/**
+ * @file opt_snapshot.cc
+ * @brief Definitions for OptSnapshot class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_snapshot.h"
+#include "appopts-private.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include <climits>
+
+/**
+ * @class OptSnapshot
+ *
+ * Holds the current immutable OptTable and lets any number of threads read
+ * it without taking locks. Writers build a new table and hand it to
+ * `publish()`, which swaps it in atomically.
+ *
+ * Reclamation uses a two-epoch scheme. A reader registers in the current
+ * epoch before loading the table pointer and re-checks the epoch after
+ * registering; a publisher swaps the pointer, flips the epoch and waits for
+ * the readers registered in the old epoch to leave before deleting
+ * the old table. Readers never wait; publishers wait only for readers
+ * that might still see the old table.
+ *
+ * Readers of a published table may store typed conversions in it; OptTable
+ * publishes them with release/acquire ordering, so concurrent readers of
+ * the same entry are safe and no conversion is computed at publish time.
+ *
+ * A thread must not publish while it holds a Reader on the same instance.
+ */
+
+/**
+ * @class OptSnapshot::Reader
+ *
+ * The reader pins the table that was current when it was constructed;
+ * values obtained through it (including references) remain valid until
+ * the reader is destroyed. Readers should be short-lived, as they delay
+ * the publishers.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an instance with no table.
+ */
+OptSnapshot::OptSnapshot () :
+    current_(NULL),
+    epoch_(0),
+    writers_()
+{
+    APPOPTS_TRACE_ENTRY;
+    readers_[0].storeRelease (0);
+    readers_[1].storeRelease (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * No reader may be active when the instance is destroyed.
+ */
+OptSnapshot::~OptSnapshot ()
+{
+    APPOPTS_TRACE_ENTRY;
+    delete current_.fetchAndStoreOrdered (NULL);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The typed caches of the table are filled by the readers as needed
+ * (OptTable publishes them safely). When the method returns no reader
+ * uses the previous table and it has been deleted.
+ *
+ * @param table the new table; the instance takes ownership
+ */
+void OptSnapshot::publish (OptTable * table)
+{
+    APPOPTS_TRACE_ENTRY;
+    QMutexLocker lock (&writers_);
+
+    OptTable * old = current_.fetchAndStoreOrdered (table);
+
+    // only publishers change the epoch and they are serialized
+    int i_epoch = epoch_.fetchAndAddOrdered (0);
+    epoch_.fetchAndStoreOrdered (1 - i_epoch);
+    while (readers_[i_epoch].fetchAndAddOrdered (0) != 0) {
+        QThread::yieldCurrentThread ();
+    }
+
+    delete old;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the epoch changes between reading it and registering, the registration
+ * is undone and retried, so a publisher never misses a reader that could
+ * see the table it is about to delete.
+ *
+ * @param snapshot the instance to read from
+ */
+OptSnapshot::Reader::Reader (const OptSnapshot & snapshot) :
+    snapshot_(snapshot),
+    epoch_(0),
+    table_(NULL)
+{
+    for (;;) {
+        epoch_ = snapshot_.epoch_.fetchAndAddOrdered (0);
+        snapshot_.readers_[epoch_].fetchAndAddOrdered (1);
+        if (snapshot_.epoch_.fetchAndAddOrdered (0) == epoch_)
+            break;
+        snapshot_.readers_[epoch_].fetchAndAddOrdered (-1);
+    }
+    table_ = snapshot_.current_.loadAcquire ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Leaves the read side.
+ */
+OptSnapshot::Reader::~Reader ()
+{
+    snapshot_.readers_[epoch_].fetchAndAddOrdered (-1);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same semantics as `AppOpts::valueB()`.
+ *
+ * @param h handle of the option to retrieve
+ * @param b_default default value if the option is not found
+ * @return the result
+ */
+bool OptSnapshot::Reader::valueB (OptHandle h, bool b_default) const
+{
+    bool result = false;
+    if ((table_ == NULL) || !table_->toBool (h.slot (), &result)) {
+        return b_default;
+    } else {
+        return result;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name name of the option to retrieve
+ * @param b_default default value if the option is not found
+ * @return the result
+ */
+bool OptSnapshot::Reader::valueB (const QString & s_name, bool b_default) const
+{
+    return valueB (OptHandle (slotOf (s_name)), b_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same semantics as `AppOpts::valueI()`.
+ *
+ * @param h handle of the option to retrieve
+ * @param i_default default value if the option is not found or
+ *        can't be converted
+ * @return the integer
+ */
+int OptSnapshot::Reader::valueI (OptHandle h, int i_default) const
+{
+    qint64 result = 0;
+    if ((table_ == NULL) || !table_->toInt (h.slot (), &result)) {
+        return i_default;
+    } else if ((result < INT_MIN) || (result > INT_MAX)) {
+        return i_default;
+    } else {
+        return static_cast<int>(result);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name name of the option to retrieve
+ * @param i_default default value if the option is not found or
+ *        can't be converted
+ * @return the integer
+ */
+int OptSnapshot::Reader::valueI (const QString & s_name, int i_default) const
+{
+    return valueI (OptHandle (slotOf (s_name)), i_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Same semantics as `AppOpts::valueD()`.
+ *
+ * @param h handle of the option to retrieve
+ * @param d_default default value if the option is not found or
+ *        can't be converted
+ * @return the number
+ */
+double OptSnapshot::Reader::valueD (OptHandle h, double d_default) const
+{
+    double result = 0.0;
+    if ((table_ == NULL) || !table_->toDouble (h.slot (), &result)) {
+        return d_default;
+    } else {
+        return result;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name name of the option to retrieve
+ * @param d_default default value if the option is not found or
+ *        can't be converted
+ * @return the number
+ */
+double OptSnapshot::Reader::valueD (const QString & s_name, double d_default) const
+{
+    return valueD (OptHandle (slotOf (s_name)), d_default);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param h handle of the option to retrieve
+ * @return the first value or an empty string if the option has no value
+ */
+const QString & OptSnapshot::Reader::valueSRef (OptHandle h) const
+{
+    static const QString s_empty;
+    const QStringList * found =
+            table_ == NULL ? NULL : table_->values (h.slot ());
+    if ((found == NULL) || found->isEmpty ()) {
+        return s_empty;
+    } else {
+        return found->at (0);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name name of the option to retrieve
+ * @return the first value or an empty string if the option has no value
+ */
+const QString & OptSnapshot::Reader::valueSRef (const QString & s_name) const
+{
+    return valueSRef (OptHandle (slotOf (s_name)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param h handle of the option to retrieve
+ * @return the list of values (may be empty)
+ */
+const QStringList & OptSnapshot::Reader::valueSLRef (OptHandle h) const
+{
+    static const QStringList sl_empty;
+    const QStringList * found =
+            table_ == NULL ? NULL : table_->values (h.slot ());
+    if (found == NULL) {
+        return sl_empty;
+    } else {
+        return *found;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_name name of the option to retrieve
+ * @return the list of values (may be empty)
+ */
+const QStringList & OptSnapshot::Reader::valueSLRef (const QString & s_name) const
+{
+    return valueSLRef (OptHandle (slotOf (s_name)));
+}
+/* ========================================================================= */
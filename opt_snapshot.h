@@ -0,0 +1,147 @@
+/**
+ * @file opt_snapshot.h
+ * @brief Declarations for OptSnapshot class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTSNAPSHOT_H_INCLUDE
+#define GUARD_APPOPTS_OPTSNAPSHOT_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+#include <appopts/opt_table.h>
+#include <appopts/opt_handle.h>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+//! Immutable option tables published for lock-free readers.
+class APPOPTS_EXPORT OptSnapshot {
+
+public:
+
+    //! Read access to the table that is current at construction time.
+    class APPOPTS_EXPORT Reader {
+
+    public:
+
+        //! Enter the read side; never blocks.
+        explicit Reader (
+                const OptSnapshot & snapshot);
+
+        //! Leave the read side.
+        ~Reader ();
+
+        //! The table (NULL if nothing was published, yet).
+        inline const OptTable *
+        table () const {
+            return table_;
+        }
+
+        //! Get a Boolean value.
+        bool
+        valueB (
+                OptHandle h,
+                bool b_default = false) const;
+
+        //! Get a Boolean value.
+        bool
+        valueB (
+                const QString & s_name,
+                bool b_default = false) const;
+
+        //! Get an integer value.
+        int
+        valueI (
+                OptHandle h,
+                int i_default = 0) const;
+
+        //! Get an integer value.
+        int
+        valueI (
+                const QString & s_name,
+                int i_default = 0) const;
+
+        //! Get a double value.
+        double
+        valueD (
+                OptHandle h,
+                double d_default = 0.0) const;
+
+        //! Get a double value.
+        double
+        valueD (
+                const QString & s_name,
+                double d_default = 0.0) const;
+
+        //! Reference to the first value; valid while the reader exists.
+        const QString &
+        valueSRef (
+                OptHandle h) const;
+
+        //! Reference to the first value; valid while the reader exists.
+        const QString &
+        valueSRef (
+                const QString & s_name) const;
+
+        //! Reference to the values; valid while the reader exists.
+        const QStringList &
+        valueSLRef (
+                OptHandle h) const;
+
+        //! Reference to the values; valid while the reader exists.
+        const QStringList &
+        valueSLRef (
+                const QString & s_name) const;
+
+    private:
+
+        //! Slot for a name in current table.
+        inline int
+        slotOf (
+                const QString & s_name) const {
+            return table_ == NULL ? -1 : table_->find (s_name);
+        }
+
+        //! not copyable
+        Reader (const Reader &);
+
+        //! not assignable
+        Reader& operator=( const Reader& );
+
+        const OptSnapshot & snapshot_; /**< the owner */
+        int epoch_; /**< the epoch we registered with */
+        const OptTable * table_; /**< table in use by this reader */
+    };
+
+    //! Default constructor.
+    OptSnapshot ();
+
+    //! Destructor.
+    ~OptSnapshot ();
+
+    //! Make a table current; takes ownership.
+    void
+    publish (
+            OptTable * table);
+
+private:
+
+    //! not copyable
+    OptSnapshot (const OptSnapshot &);
+
+    //! not assignable
+    OptSnapshot& operator=( const OptSnapshot& );
+
+    QAtomicPointer<OptTable> current_; /**< the table new readers get */
+    mutable QAtomicInt epoch_; /**< index in readers_ for new readers */
+    mutable QAtomicInt readers_[2]; /**< active readers in each epoch */
+    QMutex writers_; /**< serializes publishers */
+};
+
+#endif // GUARD_APPOPTS_OPTSNAPSHOT_H_INCLUDE
@@ -0,0 +1,503 @@
+/**
+ * @file opt_table.cc
+ * @brief Definitions for OptTable class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_table.h"
+#include "appopts-private.h"
+
+/**
+ * @class OptTable
+ *
+ * The table maps full option names to dense slots. Each slot holds the key,
+ * its precomputed hash and the list of values. Lookups use linear probing
+ * over a power-of-two bucket array, so finding a key costs one hash
+ * computation and, usually, a single string comparison.
+ *
+ * Slots are never reused or moved to a different index: removing a value
+ * simply marks the slot as not present. This keeps the slot numbers stable
+ * for the lifetime of the table.
+ *
+ * Each entry also caches the conversion of its first value to integer,
+ * double and Boolean. The conversions are computed on first typed access
+ * and are discarded whenever the values of the entry change.
+ *
+ * The typed getters are const and may run concurrently on a table that is
+ * not being changed (a published snapshot, for example), so the cache is
+ * published through the atomic `typed_` flags: a reader that computed a
+ * conversion first reserves the entry by setting TypedBusy, writes the
+ * field, then sets the flag of the conversion with release semantics.
+ * Readers only use a field after they saw its flag with acquire semantics.
+ * A reader that finds the entry reserved by another one simply returns
+ * the value it computed without storing it. The methods that change the
+ * values are not safe to call concurrently with any reader.
+ */
+
+//! initial number of buckets; must be a power of two
+#define OPTTABLE_MIN_CAPACITY 16
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty table.
+ */
+OptTable::OptTable () :
+    entries_(),
+    buckets_(),
+    present_count_(0)
+{
+    APPOPTS_TRACE_ENTRY;
+    rehash (OPTTABLE_MIN_CAPACITY);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptTable::~OptTable ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The hash is compared first and the key only when the hashes match.
+ *
+ * @param s_key the full name of the option
+ * @param hash the hash of the key as computed by `hashKey()`
+ * @return the slot or -1 if the key was never inserted
+ */
+int OptTable::find (const QString & s_key, uint hash) const
+{
+    int mask = buckets_.count () - 1;
+    int i = hash & mask;
+    for (;;) {
+        int i_slot = buckets_.at (i);
+        if (i_slot == -1) {
+            return -1;
+        }
+        const Entry & e = entries_.at (i_slot);
+        if ((e.hash_ == hash) && (e.key_ == s_key)) {
+            return i_slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the key is not present a new slot is created for it; the new slot
+ * holds no value.
+ *
+ * @param s_key the full name of the option
+ * @param hash the hash of the key as computed by `hashKey()`
+ * @return the slot
+ */
+int OptTable::slot (const QString & s_key, uint hash)
+{
+    int mask = buckets_.count () - 1;
+    int i = hash & mask;
+    for (;;) {
+        int i_slot = buckets_.at (i);
+        if (i_slot == -1) {
+            break;
+        }
+        const Entry & e = entries_.at (i_slot);
+        if ((e.hash_ == hash) && (e.key_ == s_key)) {
+            return i_slot;
+        }
+        i = (i + 1) & mask;
+    }
+
+    Entry e;
+    e.key_ = s_key;
+    e.hash_ = hash;
+    e.present_ = false;
+    e.typed_.storeRelease (0);
+    e.int_ = 0;
+    e.dbl_ = 0.0;
+    e.bool_ = false;
+    int i_slot = entries_.count ();
+    entries_.append (e);
+
+    // keep the load factor at or below one half
+    if (entries_.count () * 2 > buckets_.count ()) {
+        rehash (buckets_.count () * 2);
+    } else {
+        buckets_[i] = i_slot;
+    }
+    return i_slot;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `slot()`
+ * @param sl_values new values
+ */
+void OptTable::setValues (int i_slot, const QStringList & sl_values)
+{
+    Entry & e = entries_[i_slot];
+    if (!e.present_) {
+        e.present_ = true;
+        ++present_count_;
+    }
+    e.values_ = sl_values;
+    e.typed_.storeRelease (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the slot holds no value the result is the same as for `setValues()`.
+ *
+ * @param i_slot a slot returned by `slot()`
+ * @param sl_values values to append
+ */
+void OptTable::appendValues (int i_slot, const QStringList & sl_values)
+{
+    Entry & e = entries_[i_slot];
+    if (!e.present_) {
+        e.present_ = true;
+        ++present_count_;
+        e.values_ = sl_values;
+    } else {
+        e.values_.append (sl_values);
+    }
+    e.typed_.storeRelease (0);
+}
+/* ========================================================================= */
+
+#ifdef Q_COMPILER_RVALUE_REFS
+/* ------------------------------------------------------------------------- */
+/**
+ * @param i_slot a slot returned by `slot()`
+ * @param sl_values new values; left empty
+ */
+void OptTable::setValues (int i_slot, QStringList && sl_values)
+{
+    Entry & e = entries_[i_slot];
+    if (!e.present_) {
+        e.present_ = true;
+        ++present_count_;
+    }
+    e.values_ = std::move (sl_values);
+    e.typed_.storeRelease (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the slot holds no value the list is taken over as it is.
+ *
+ * @param i_slot a slot returned by `slot()`
+ * @param sl_values values to append; left empty if the slot was empty
+ */
+void OptTable::appendValues (int i_slot, QStringList && sl_values)
+{
+    Entry & e = entries_[i_slot];
+    if (!e.present_) {
+        e.present_ = true;
+        ++present_count_;
+        e.values_ = std::move (sl_values);
+    } else {
+        e.values_.append (sl_values);
+    }
+    e.typed_.storeRelease (0);
+}
+/* ========================================================================= */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The slot itself is preserved so that it may be filled again later.
+ *
+ * @param i_slot a slot returned by `slot()`
+ */
+void OptTable::remove (int i_slot)
+{
+    Entry & e = entries_[i_slot];
+    if (e.present_) {
+        e.present_ = false;
+        --present_count_;
+    }
+    e.values_.clear ();
+    e.typed_.storeRelease (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Slots are preserved so that they may be filled again later.
+ */
+void OptTable::clear ()
+{
+    int i_max = entries_.count ();
+    for (int i = 0; i < i_max; ++i) {
+        Entry & e = entries_[i];
+        e.present_ = false;
+        e.values_.clear ();
+        e.typed_.storeRelease (0);
+    }
+    present_count_ = 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The conversion is performed on first call and cached in the entry
+ * (see the notes about concurrent readers in the class description).
+ *
+ * @param i_slot the slot (may be -1)
+ * @param out receives the value; not changed if the method fails
+ * @return false if the slot holds no value, the list is empty or the
+ *         first value is not an integer
+ */
+bool OptTable::toInt (int i_slot, qint64 * out) const
+{
+    if ((i_slot < 0) || (i_slot >= entries_.count ()))
+        return false;
+    const Entry & e = entries_.at (i_slot);
+    if (!e.present_ || e.values_.isEmpty ())
+        return false;
+
+    int typed = e.typed_.loadAcquire ();
+    if ((typed & IntCached) == 0) {
+        bool b_ok = false;
+        qint64 i_value = e.values_.at (0).toLongLong (&b_ok);
+        if (claimTyped (e, typed)) {
+            e.int_ = i_value;
+            e.typed_.storeRelease (
+                        typed | (b_ok ? IntCached : (IntCached | IntFailed)));
+        }
+        if (!b_ok)
+            return false;
+        *out = i_value;
+        return true;
+    }
+    if ((typed & IntFailed) != 0)
+        return false;
+    *out = e.int_;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The conversion is performed on first call and cached in the entry
+ * (see the notes about concurrent readers in the class description).
+ *
+ * @param i_slot the slot (may be -1)
+ * @param out receives the value; not changed if the method fails
+ * @return false if the slot holds no value, the list is empty or the
+ *         first value is not a number
+ */
+bool OptTable::toDouble (int i_slot, double * out) const
+{
+    if ((i_slot < 0) || (i_slot >= entries_.count ()))
+        return false;
+    const Entry & e = entries_.at (i_slot);
+    if (!e.present_ || e.values_.isEmpty ())
+        return false;
+
+    int typed = e.typed_.loadAcquire ();
+    if ((typed & DoubleCached) == 0) {
+        bool b_ok = false;
+        double d_value = e.values_.at (0).toDouble (&b_ok);
+        if (claimTyped (e, typed)) {
+            e.dbl_ = d_value;
+            e.typed_.storeRelease (
+                        typed | (b_ok ? DoubleCached :
+                                        (DoubleCached | DoubleFailed)));
+        }
+        if (!b_ok)
+            return false;
+        *out = d_value;
+        return true;
+    }
+    if ((typed & DoubleFailed) != 0)
+        return false;
+    *out = e.dbl_;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The first value is compared against `FALSE`, `false` and `0`;
+ * if the string matches the value is false, otherwise it is true.
+ * The conversion is performed on first call and cached in the entry
+ * (see the notes about concurrent readers in the class description).
+ *
+ * @param i_slot the slot (may be -1)
+ * @param out receives the value; not changed if the method fails
+ * @return false if the slot holds no value or the list is empty
+ */
+bool OptTable::toBool (int i_slot, bool * out) const
+{
+    if ((i_slot < 0) || (i_slot >= entries_.count ()))
+        return false;
+    const Entry & e = entries_.at (i_slot);
+    if (!e.present_ || e.values_.isEmpty ())
+        return false;
+
+    int typed = e.typed_.loadAcquire ();
+    if ((typed & BoolCached) == 0) {
+        const QString & s_value = e.values_.at (0);
+        bool b_value = !(
+                (s_value == "FALSE") ||
+                (s_value == "false") ||
+                (s_value == "0"));
+        if (claimTyped (e, typed)) {
+            e.bool_ = b_value;
+            e.typed_.storeRelease (typed | BoolCached);
+        }
+        *out = b_value;
+        return true;
+    }
+    *out = e.bool_;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * After this call the typed getters only read the entries, so readers of
+ * a table that is no longer changed never contend for the typed cache.
+ */
+void OptTable::primeCache () const
+{
+    qint64 i_value;
+    double d_value;
+    bool b_value;
+    int i_max = entries_.count ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        toInt (i_slot, &i_value);
+        toDouble (i_slot, &d_value);
+        toBool (i_slot, &b_value);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Used with conversions that were stored by a previous run (see
+ * OptBinCache); the caller must make sure that they were computed from
+ * the current first value of the slot. Nothing is changed if some
+ * conversions are already cached.
+ *
+ * @param i_slot the slot (may be -1)
+ * @param typed combination of TypedFlags describing the conversions
+ * @param i_value integer conversion
+ * @param d_value double conversion
+ * @param b_value Boolean conversion
+ */
+void OptTable::primeTyped (
+        int i_slot, int typed, qint64 i_value,
+        double d_value, bool b_value) const
+{
+    if ((i_slot < 0) || (i_slot >= entries_.count ()))
+        return;
+    const Entry & e = entries_.at (i_slot);
+    if (!e.present_ || e.values_.isEmpty () || !claimTyped (e, 0))
+        return;
+    e.int_ = i_value;
+    e.dbl_ = d_value;
+    e.bool_ = b_value;
+    e.typed_.storeRelease (typed & ~TypedBusy);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The rules are the same as for `toInt()`, `toDouble()` and `toBool()`.
+ *
+ * @param s_value the value to convert
+ * @param i_out receives the integer conversion
+ * @param d_out receives the double conversion
+ * @param b_out receives the Boolean conversion
+ * @return the TypedFlags that describe the conversions
+ */
+int OptTable::convertValue (
+        const QString & s_value, qint64 * i_out,
+        double * d_out, bool * b_out)
+{
+    int typed = IntCached | DoubleCached | BoolCached;
+    bool b_ok = false;
+    *i_out = s_value.toLongLong (&b_ok);
+    if (!b_ok)
+        typed |= IntFailed;
+    *d_out = s_value.toDouble (&b_ok);
+    if (!b_ok)
+        typed |= DoubleFailed;
+    *b_out = !(
+            (s_value == "FALSE") ||
+            (s_value == "false") ||
+            (s_value == "0"));
+    return typed;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * This is the compatibility path for code that needs to walk the options
+ * in the same order that a `QMap` would provide.
+ *
+ * @return the list of keys
+ */
+QStringList OptTable::sortedKeys () const
+{
+    QStringList result;
+    result.reserve (present_count_);
+    foreach (const Entry & e, entries_) {
+        if (e.present_) {
+            result.append (e.key_);
+        }
+    }
+    result.sort ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return a map with all keys that hold a value
+ */
+QMap<QString,QStringList> OptTable::toMap () const
+{
+    QMap<QString,QStringList> result;
+    foreach (const Entry & e, entries_) {
+        if (e.present_) {
+            result.insert (e.key_, e.values_);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The hashes stored in the entries are reused, so no key is hashed again.
+ *
+ * @param i_capacity new number of buckets; must be a power of two
+ */
+void OptTable::rehash (int i_capacity)
+{
+    buckets_.fill (-1, i_capacity);
+    int mask = i_capacity - 1;
+    int i_max = entries_.count ();
+    for (int i_slot = 0; i_slot < i_max; ++i_slot) {
+        int i = entries_.at (i_slot).hash_ & mask;
+        while (buckets_.at (i) != -1) {
+            i = (i + 1) & mask;
+        }
+        buckets_[i] = i_slot;
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,224 @@
+/**
+ * @file opt_table.h
+ * @brief Declarations for OptTable class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTTABLE_H_INCLUDE
+#define GUARD_APPOPTS_OPTTABLE_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QMap>
+#include <QHash>
+#include <QAtomicInt>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#ifdef Q_COMPILER_RVALUE_REFS
+#include <utility>
+#endif
+
+//! Open-addressing hash table holding option values.
+class APPOPTS_EXPORT OptTable {
+
+public:
+
+    //! Flags describing the typed cache of an entry.
+    enum TypedFlags {
+        IntCached = 0x01, /**< int_ was computed */
+        IntFailed = 0x02, /**< first value is not an integer */
+        DoubleCached = 0x04, /**< dbl_ was computed */
+        DoubleFailed = 0x08, /**< first value is not a number */
+        BoolCached = 0x10, /**< bool_ was computed */
+        TypedBusy = 0x20 /**< a reader is storing a conversion */
+    };
+
+    //! One slot in the table.
+    struct Entry {
+        QString key_; /**< full name of the option */
+        uint hash_; /**< precomputed hash of the key */
+        QStringList values_; /**< the values */
+        bool present_; /**< does this slot hold a value? */
+        mutable QAtomicInt typed_; /**< combination of TypedFlags */
+        mutable qint64 int_; /**< cached integer conversion (see typed_) */
+        mutable double dbl_; /**< cached double conversion (see typed_) */
+        mutable bool bool_; /**< cached Boolean conversion (see typed_) */
+    };
+
+    //! Default constructor.
+    OptTable ();
+
+    //! Destructor.
+    ~OptTable();
+
+    //! The hash used for keys.
+    static inline uint
+    hashKey (
+            const QString & s_key) {
+        return qHash (s_key);
+    }
+
+    //! Locate the slot of a key (-1 if never inserted).
+    inline int
+    find (
+            const QString & s_key) const {
+        return find (s_key, hashKey (s_key));
+    }
+
+    //! Locate the slot of a key using a precomputed hash.
+    int
+    find (
+            const QString & s_key,
+            uint hash) const;
+
+    //! Locate or create the slot for a key.
+    inline int
+    slot (
+            const QString & s_key) {
+        return slot (s_key, hashKey (s_key));
+    }
+
+    //! Locate or create the slot for a key using a precomputed hash.
+    int
+    slot (
+            const QString & s_key,
+            uint hash);
+
+    //! Replace the values in a slot.
+    void
+    setValues (
+            int i_slot,
+            const QStringList & sl_values);
+
+    //! Append to the values in a slot.
+    void
+    appendValues (
+            int i_slot,
+            const QStringList & sl_values);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    //! Replace the values in a slot, taking over the list.
+    void
+    setValues (
+            int i_slot,
+            QStringList && sl_values);
+
+    //! Append to the values in a slot, taking over the list.
+    void
+    appendValues (
+            int i_slot,
+            QStringList && sl_values);
+#endif
+
+    //! Mark a slot as holding no value.
+    void
+    remove (
+            int i_slot);
+
+    //! Mark all slots as holding no value.
+    void
+    clear ();
+
+    //! The values in a slot or NULL if the slot holds no value.
+    inline const QStringList *
+    values (
+            int i_slot) const {
+        if ((i_slot < 0) || (i_slot >= entries_.count ()))
+            return NULL;
+        const Entry & e = entries_.at (i_slot);
+        return e.present_ ? &e.values_ : NULL;
+    }
+
+    //! First value in a slot converted to an integer.
+    bool
+    toInt (
+            int i_slot,
+            qint64 * out) const;
+
+    //! First value in a slot converted to a double.
+    bool
+    toDouble (
+            int i_slot,
+            double * out) const;
+
+    //! First value in a slot converted to a Boolean.
+    bool
+    toBool (
+            int i_slot,
+            bool * out) const;
+
+    //! Compute all typed conversions in advance.
+    void
+    primeCache () const;
+
+    //! Install typed conversions of the first value computed elsewhere.
+    void
+    primeTyped (
+            int i_slot,
+            int typed,
+            qint64 i_value,
+            double d_value,
+            bool b_value) const;
+
+    //! Compute all typed conversions of a value (returns TypedFlags).
+    static int
+    convertValue (
+            const QString & s_value,
+            qint64 * i_out,
+            double * d_out,
+            bool * b_out);
+
+    //! The entry in a slot.
+    inline const Entry &
+    entry (
+            int i_slot) const {
+        return entries_.at (i_slot);
+    }
+
+    //! Number of slots (present or not).
+    inline int
+    slotCount () const {
+        return entries_.count ();
+    }
+
+    //! Number of slots that hold a value.
+    inline int
+    count () const {
+        return present_count_;
+    }
+
+    //! The keys that hold a value, sorted.
+    QStringList
+    sortedKeys () const;
+
+    //! Sorted copy of the content.
+    QMap<QString,QStringList>
+    toMap () const;
+
+private:
+
+    //! Reserve the typed cache of an entry for storing a conversion.
+    static inline bool
+    claimTyped (
+            const Entry & e,
+            int typed) {
+        return ((typed & TypedBusy) == 0) &&
+                e.typed_.testAndSetAcquire (typed, typed | TypedBusy);
+    }
+
+    //! Rebuild the buckets with given capacity (power of two).
+    void
+    rehash (
+            int i_capacity);
+
+    QVector<Entry> entries_; /**< dense array of slots */
+    QVector<int> buckets_; /**< open-addressing index into entries_ */
+    int present_count_; /**< number of slots holding a value */
+};
+
+#endif // GUARD_APPOPTS_OPTTABLE_H_INCLUDE
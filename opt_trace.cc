@@ -0,0 +1,232 @@
+/**
+ * @file opt_trace.cc
+ * @brief Definitions for OptTrace class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_trace.h"
+#include "appopts-private.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+/**
+ * @class OptTrace
+ *
+ * Tracing is off until a sink is installed with `setSink()`. Library code
+ * marks the work it does with OptTraceScope instances (the
+ * `APPOPTS_TRACE_ENTRY` macro creates one for the enclosing function);
+ * while no sink is installed a scope only loads the sink pointer.
+ *
+ * The library reports these spans:
+ * - `loadFromAll`, `loadFile`, `readMultipleFromCfgs` and
+ *   `readValueFromCfgs` for the public entry points;
+ * - `locate` and `parse` for each configuration file (the detail is
+ *   the kind of file or its path);
+ * - `versionCheck` for each file that was loaded;
+ * - `readOption` for each option read from a file (the detail is its
+ *   full name);
+ * - the constructors, destructors and other functions that use
+ *   `APPOPTS_TRACE_ENTRY`.
+ *
+ * Defining `APPOPTS_NO_TRACE` when building the library removes
+ * the scopes altogether.
+ */
+
+/**
+ * @class OptTraceScope
+ *
+ * The sink is captured when the scope starts, so a span that started
+ * while tracing was enabled is delivered to the same sink. A sink must
+ * therefore outlive the work that was running when it was removed.
+ */
+
+/**
+ * @class OptChromeTrace
+ *
+ * Events are stored in memory, in the order they ended, and exported as
+ * complete (`"ph": "X"`) events with microsecond timestamps. Thread ids are
+ * replaced by small numbers in the order the threads were first seen.
+ */
+
+namespace {
+
+//! Reference point for OptTrace::now().
+struct TraceClock {
+    TraceClock () : timer_() { timer_.start (); }
+    QElapsedTimer timer_;
+};
+
+static TraceClock trace_clock;
+
+} // namespace
+
+QAtomicPointer<OptTraceSink> OptTrace::sink_;
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The sink is not owned. Spans that are in progress still report to
+ * the sink that was installed when they started.
+ *
+ * @param sink the new sink or NULL
+ */
+void OptTrace::setSink (OptTraceSink * sink)
+{
+    sink_.storeRelease (sink);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return nanoseconds since the library was loaded
+ */
+qint64 OptTrace::now ()
+{
+    return trace_clock.timer_.nsecsElapsed ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only called if the scope started while tracing was enabled.
+ */
+void OptTraceScope::finish ()
+{
+    OptTraceEvent e;
+    e.name_ = name_;
+    e.category_ = category_;
+    e.detail_ = detail_;
+    e.start_ns_ = start_ns_;
+    e.duration_ns_ = OptTrace::now () - start_ns_;
+    e.thread_ = reinterpret_cast<quintptr>(QThread::currentThreadId ());
+    sink_->event (e);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty collector. The collector does not trace itself, so
+ * it may be installed as a sink while it is being created or destroyed.
+ */
+OptChromeTrace::OptChromeTrace () : OptTraceSink (),
+    lock_(),
+    events_(),
+    threads_()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptChromeTrace::~OptChromeTrace ()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param e the event
+ */
+void OptChromeTrace::event (const OptTraceEvent & e)
+{
+    QMutexLocker lock (&lock_);
+    events_.append (e);
+    if (!threads_.contains (e.thread_)) {
+        threads_.insert (e.thread_, threads_.count () + 1);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return number of events collected so far
+ */
+int OptChromeTrace::count () const
+{
+    QMutexLocker lock (&lock_);
+    return events_.count ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Thread numbering starts again as well.
+ */
+void OptChromeTrace::clear ()
+{
+    QMutexLocker lock (&lock_);
+    events_.clear ();
+    threads_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the document; an object with a `traceEvents` array
+ */
+QByteArray OptChromeTrace::toJson () const
+{
+    QMutexLocker lock (&lock_);
+    double pid = static_cast<double>(QCoreApplication::applicationPid ());
+
+    QJsonArray events;
+    foreach (const OptTraceEvent & e, events_) {
+        QJsonObject obj;
+        obj.insert ("name", QString::fromLatin1 (e.name_));
+        obj.insert ("cat", QString::fromLatin1 (e.category_));
+        obj.insert ("ph", QString ("X"));
+        obj.insert ("ts", e.start_ns_ / 1000.0);
+        obj.insert ("dur", e.duration_ns_ / 1000.0);
+        obj.insert ("pid", pid);
+        obj.insert ("tid", threads_.value (e.thread_));
+        if (!e.detail_.isEmpty ()) {
+            QJsonObject args;
+            args.insert ("detail", e.detail_);
+            obj.insert ("args", args);
+        }
+        events.append (obj);
+    }
+
+    QJsonObject root;
+    root.insert ("traceEvents", events);
+    root.insert ("displayTimeUnit", QString ("ns"));
+    return QJsonDocument (root).toJson (QJsonDocument::Compact);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_path destination file; replaced atomically
+ * @param s_error receives a description of the error, if any
+ * @return true if the file was written
+ */
+bool OptChromeTrace::save (const QString & s_path, QString * s_error) const
+{
+    QSaveFile file (s_path);
+    if (!file.open (QIODevice::WriteOnly)) {
+        if (s_error != NULL) {
+            *s_error = file.errorString ();
+        }
+        return false;
+    }
+    file.write (toJson ());
+    if (!file.commit ()) {
+        if (s_error != NULL) {
+            *s_error = file.errorString ();
+        }
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
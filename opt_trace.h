@@ -0,0 +1,185 @@
+/**
+ * @file opt_trace.h
+ * @brief Declarations for OptTrace class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTTRACE_H_INCLUDE
+#define GUARD_APPOPTS_OPTTRACE_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+//! One timed span of work.
+struct APPOPTS_EXPORT OptTraceEvent {
+    const char * name_; /**< what was done (static string) */
+    const char * category_; /**< the area of the library (static string) */
+    QString detail_; /**< file, option or other argument (may be empty) */
+    qint64 start_ns_; /**< start, see OptTrace::now() */
+    qint64 duration_ns_; /**< duration */
+    quintptr thread_; /**< the thread that did the work */
+};
+
+//! Receives the events produced while tracing is enabled.
+class APPOPTS_EXPORT OptTraceSink {
+
+public:
+
+    //! Destructor.
+    virtual ~OptTraceSink () {}
+
+    //! Called in the thread that did the work.
+    virtual void
+    event (
+            const OptTraceEvent & e) = 0;
+};
+
+//! Process-wide entry point for tracing.
+class APPOPTS_EXPORT OptTrace {
+
+public:
+
+    //! Install a sink; NULL disables tracing.
+    static void
+    setSink (
+            OptTraceSink * sink);
+
+    //! The installed sink (NULL if tracing is disabled).
+    static inline OptTraceSink *
+    sink () {
+        return sink_.loadAcquire ();
+    }
+
+    //! Monotonic time in nanoseconds.
+    static qint64
+    now ();
+
+private:
+
+    static QAtomicPointer<OptTraceSink> sink_; /**< where events go */
+};
+
+//! Times the enclosing scope while tracing is enabled.
+class APPOPTS_EXPORT OptTraceScope {
+
+public:
+
+    //! Start a span.
+    explicit OptTraceScope (
+            const char * name,
+            const char * category = "appopts") :
+        sink_(OptTrace::sink ()),
+        name_(name),
+        category_(category),
+        detail_(),
+        start_ns_(0)
+    {
+        if (sink_ != NULL) {
+            start_ns_ = OptTrace::now ();
+        }
+    }
+
+    //! Start a span with an argument.
+    OptTraceScope (
+            const char * name,
+            const char * category,
+            const QString & detail) :
+        sink_(OptTrace::sink ()),
+        name_(name),
+        category_(category),
+        detail_(),
+        start_ns_(0)
+    {
+        if (sink_ != NULL) {
+            detail_ = detail;
+            start_ns_ = OptTrace::now ();
+        }
+    }
+
+    //! Is the span being traced?
+    inline bool
+    enabled () const {
+        return sink_ != NULL;
+    }
+
+    //! Attach an argument to a span that is being traced.
+    inline void
+    setDetail (
+            const QString & detail) {
+        detail_ = detail;
+    }
+
+    //! End the span.
+    ~OptTraceScope () {
+        if (sink_ != NULL) {
+            finish ();
+        }
+    }
+
+private:
+
+    //! Hand the event to the sink.
+    void
+    finish ();
+
+    OptTraceScope (const OptTraceScope &);
+    OptTraceScope & operator= (const OptTraceScope &);
+
+    OptTraceSink * sink_; /**< sink at the start (NULL if disabled) */
+    const char * name_; /**< what is being done */
+    const char * category_; /**< area of the library */
+    QString detail_; /**< argument */
+    qint64 start_ns_; /**< start time */
+};
+
+//! Collects events and exports them in Chrome trace-event format.
+class APPOPTS_EXPORT OptChromeTrace : public OptTraceSink {
+
+public:
+
+    //! Default constructor.
+    OptChromeTrace ();
+
+    //! Destructor.
+    virtual ~OptChromeTrace ();
+
+    //! Store an event.
+    virtual void
+    event (
+            const OptTraceEvent & e);
+
+    //! Number of stored events.
+    int
+    count () const;
+
+    //! Drop all stored events.
+    void
+    clear ();
+
+    //! The events as a JSON document for `chrome://tracing` or Perfetto.
+    QByteArray
+    toJson () const;
+
+    //! Write the JSON document to a file.
+    bool
+    save (
+            const QString & s_path,
+            QString * s_error = NULL) const;
+
+private:
+
+    mutable QMutex lock_; /**< protects the members below */
+    QList<OptTraceEvent> events_; /**< collected events */
+    QHash<quintptr,int> threads_; /**< small numbers for thread ids */
+};
+
+#endif // GUARD_APPOPTS_OPTTRACE_H_INCLUDE
@@ -0,0 +1,189 @@
+/**
+ * @file opt_trie.cc
+ * @brief Definitions for OptTrie class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_trie.h"
+#include "appopts-private.h"
+
+/**
+ * @class OptTrie
+ *
+ * Full names are split at `/` and each segment is a node in the trie, so
+ * all the keys in a group live in the subtree of the group's node.
+ * Locating a group costs one map lookup per segment of the group name;
+ * enumerating it only visits its subtree. Children are kept ordered, so
+ * keys are produced in segment order.
+ *
+ * Terminal nodes store the slot of the key in an OptTable. Keys are never
+ * removed, in the same way slots are never removed from the table.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Creates an empty trie.
+ */
+OptTrie::OptTrie () :
+    nodes_(),
+    count_(0)
+{
+    APPOPTS_TRACE_ENTRY;
+    clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptTrie::~OptTrie ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the key is already present its slot is replaced.
+ *
+ * @param s_key full name of the option
+ * @param i_slot the slot
+ */
+void OptTrie::insert (const QString & s_key, int i_slot)
+{
+    int i_node = 0;
+    int i_start = 0;
+    for (;;) {
+        int i_sep = s_key.indexOf (QChar('/'), i_start);
+        QString s_segment = (i_sep == -1) ?
+                    s_key.mid (i_start) :
+                    s_key.mid (i_start, i_sep - i_start);
+
+        QMap<QString,int>::const_iterator child =
+                nodes_.at (i_node).children_.constFind (s_segment);
+        if (child == nodes_.at (i_node).children_.constEnd ()) {
+            int i_new = nodes_.count ();
+            Node n;
+            n.slot_ = -1;
+            nodes_.append (n);
+            nodes_[i_node].children_.insert (s_segment, i_new);
+            i_node = i_new;
+        } else {
+            i_node = child.value ();
+        }
+
+        if (i_sep == -1)
+            break;
+        i_start = i_sep + 1;
+    }
+
+    if (nodes_.at (i_node).slot_ == -1) {
+        ++count_;
+    }
+    nodes_[i_node].slot_ = i_slot;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_key full name of the option
+ * @return the slot or -1
+ */
+int OptTrie::find (const QString & s_key) const
+{
+    int i_node = nodeOf (s_key);
+    return i_node == -1 ? -1 : nodes_.at (i_node).slot_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A trailing `/` in the name of the group is ignored. An empty name
+ * means all keys. A key equal to the name of the group is not part of it.
+ *
+ * @param s_group name of the group, possibly with several segments
+ * @return the slots
+ */
+QVector<int> OptTrie::slotsUnder (const QString & s_group) const
+{
+    QVector<int> result;
+    int i_root = 0;
+    if (!s_group.isEmpty ()) {
+        QString s_path = s_group;
+        if (s_path.endsWith (QChar('/'))) {
+            s_path.chop (1);
+        }
+        i_root = nodeOf (s_path);
+        if (i_root == -1)
+            return result;
+    }
+
+    // depth first, children in order
+    QVector<int> stack;
+    const QMap<QString,int> & top = nodes_.at (i_root).children_;
+    for (QMap<QString,int>::const_iterator i = top.constEnd (); i != top.constBegin ();) {
+        --i;
+        stack.append (i.value ());
+    }
+    while (!stack.isEmpty ()) {
+        int i_node = stack.last ();
+        stack.removeLast ();
+        const Node & n = nodes_.at (i_node);
+        if (n.slot_ != -1) {
+            result.append (n.slot_);
+        }
+        for (QMap<QString,int>::const_iterator i = n.children_.constEnd ();
+             i != n.children_.constBegin ();) {
+            --i;
+            stack.append (i.value ());
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only the root is left.
+ */
+void OptTrie::clear ()
+{
+    nodes_.clear ();
+    Node root;
+    root.slot_ = -1;
+    nodes_.append (root);
+    count_ = 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_path segments separated by `/`
+ * @return the index of the node or -1
+ */
+int OptTrie::nodeOf (const QString & s_path) const
+{
+    int i_node = 0;
+    int i_start = 0;
+    for (;;) {
+        int i_sep = s_path.indexOf (QChar('/'), i_start);
+        QString s_segment = (i_sep == -1) ?
+                    s_path.mid (i_start) :
+                    s_path.mid (i_start, i_sep - i_start);
+
+        const QMap<QString,int> & children = nodes_.at (i_node).children_;
+        QMap<QString,int>::const_iterator child = children.constFind (s_segment);
+        if (child == children.constEnd ())
+            return -1;
+        i_node = child.value ();
+
+        if (i_sep == -1)
+            return i_node;
+        i_start = i_sep + 1;
+    }
+}
+/* ========================================================================= */
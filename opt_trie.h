@@ -0,0 +1,73 @@
+/**
+ * @file opt_trie.h
+ * @brief Declarations for OptTrie class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTTRIE_H_INCLUDE
+#define GUARD_APPOPTS_OPTTRIE_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+//! Index of full option names by their `/`-separated segments.
+class APPOPTS_EXPORT OptTrie {
+
+public:
+
+    //! Default constructor.
+    OptTrie ();
+
+    //! Destructor.
+    ~OptTrie ();
+
+    //! Add a key and the slot it refers to.
+    void
+    insert (
+            const QString & s_key,
+            int i_slot);
+
+    //! The slot of a key (-1 if not present).
+    int
+    find (
+            const QString & s_key) const;
+
+    //! The slots of all keys below a group, in segment order.
+    QVector<int>
+    slotsUnder (
+            const QString & s_group) const;
+
+    //! Number of keys.
+    inline int
+    count () const {
+        return count_;
+    }
+
+    //! Remove all keys.
+    void
+    clear ();
+
+private:
+
+    //! One segment of a key.
+    struct Node {
+        QMap<QString,int> children_; /**< next segments and their nodes */
+        int slot_; /**< slot of the key ending here or -1 */
+    };
+
+    //! The node for a path of segments (-1 if not present).
+    int
+    nodeOf (
+            const QString & s_path) const;
+
+    QVector<Node> nodes_; /**< the nodes; first one is the root */
+    int count_; /**< number of keys */
+};
+
+#endif // GUARD_APPOPTS_OPTTRIE_H_INCLUDE
@@ -0,0 +1,211 @@
+/**
+ * @file opt_validator.cc
+ * @brief Definitions for OptValidator class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_validator.h"
+#include "one_opt_list.h"
+#include "opt_table.h"
+#include "appopts-private.h"
+
+/**
+ * @class OptValidator
+ *
+ * The constraints in each OneOpt (see OptConstraints) are turned into
+ * rules when the instance is created: regular expressions are anchored
+ * and compiled (and optimized with Qt 5.4 or later), and choices go into
+ * a hash set. Options without constraints get no rule, so the cost of a
+ * check only depends on the options that have them.
+ *
+ * The instance can then be used any number of times. `validate()` walks
+ * all the rules in a single pass and collects one message for each
+ * problem instead of stopping at the first one; options without a value
+ * are skipped, since their presence is handled by `OneOpt::required()`.
+ *
+ * An invalid pattern is reported in `compileErrors()` and rejects all
+ * the values of its option.
+ */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param list the definitions of the options
+ */
+OptValidator::OptValidator (const OneOptList & list) :
+    rules_(),
+    compile_errors_()
+{
+    APPOPTS_TRACE_ENTRY;
+    foreach (const OneOpt & opt, list) {
+        const OptConstraints & c = opt.constraints ();
+        if (c.isEmpty ())
+            continue;
+
+        Rule rule;
+        rule.key_ = opt.fullName ();
+        rule.hash_ = opt.fullHash ();
+        rule.checks_ = c.checks_;
+        rule.int_min_ = c.int_min_;
+        rule.int_max_ = c.int_max_;
+        rule.double_min_ = c.double_min_;
+        rule.double_max_ = c.double_max_;
+        rule.count_min_ = c.count_min_;
+        rule.count_max_ = c.count_max_;
+        if (c.has (OptConstraints::ChoicesCheck)) {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+            rule.choices_ = QSet<QString> (
+                        c.choices_.begin (), c.choices_.end ());
+#else
+            rule.choices_ = c.choices_.toSet ();
+#endif
+        }
+        if (c.has (OptConstraints::PatternCheck)) {
+            rule.pattern_.setPattern (
+                        QString ("\\A(?:%1)\\z").arg (c.pattern_));
+            if (!rule.pattern_.isValid ()) {
+                compile_errors_.append (
+                            QString ("Option %1: invalid pattern %2 (%3).")
+                            .arg (rule.key_)
+                            .arg (c.pattern_)
+                            .arg (rule.pattern_.errorString ()));
+            }
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
+            // compile now rather than on the first match
+            rule.pattern_.optimize ();
+#endif
+        }
+        rules_.append (rule);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Releases all resources associated with this instance.
+ */
+OptValidator::~OptValidator ()
+{
+    APPOPTS_TRACE_ENTRY;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * All the checks of the option are performed on all the values, so that
+ * every problem is reported.
+ *
+ * @param i index of the rule (less than `count()`)
+ * @param values the values of the option
+ * @param errors messages are appended here (may be NULL)
+ * @return true if the values are acceptable
+ */
+bool OptValidator::check (
+        int i, const QStringList & values, QStringList * errors) const
+{
+    const Rule & rule = rules_.at (i);
+    bool b_ret = true;
+
+    if (rule.checks_ & OptConstraints::CountCheck) {
+        if ((values.count () < rule.count_min_) ||
+                (values.count () > rule.count_max_)) {
+            b_ret = false;
+            if (errors != NULL) {
+                errors->append (
+                            QString ("Option %1 has %2 values; "
+                                     "between %3 and %4 are expected.")
+                            .arg (rule.key_)
+                            .arg (values.count ())
+                            .arg (rule.count_min_)
+                            .arg (rule.count_max_));
+            }
+        }
+    }
+
+    foreach (const QString & s_value, values) {
+        bool b_ok = true;
+        QString s_expected;
+
+        if (rule.checks_ & OptConstraints::IntRangeCheck) {
+            bool b_conv = false;
+            qint64 i_value = s_value.toLongLong (&b_conv);
+            if (!b_conv || (i_value < rule.int_min_) ||
+                    (i_value > rule.int_max_)) {
+                b_ok = false;
+                s_expected = QString ("an integer between %1 and %2")
+                        .arg (rule.int_min_).arg (rule.int_max_);
+            }
+        }
+        if (b_ok && (rule.checks_ & OptConstraints::DoubleRangeCheck)) {
+            bool b_conv = false;
+            double d_value = s_value.toDouble (&b_conv);
+            // the negated form also rejects NaN
+            if (!b_conv || !((d_value >= rule.double_min_) &&
+                             (d_value <= rule.double_max_))) {
+                b_ok = false;
+                s_expected = QString ("a number between %1 and %2")
+                        .arg (rule.double_min_).arg (rule.double_max_);
+            }
+        }
+        if (b_ok && (rule.checks_ & OptConstraints::ChoicesCheck)) {
+            if (!rule.choices_.contains (s_value)) {
+                b_ok = false;
+                QStringList choices = rule.choices_.values ();
+                choices.sort ();
+                s_expected = QString ("one of %1")
+                        .arg (choices.join (", "));
+            }
+        }
+        if (b_ok && (rule.checks_ & OptConstraints::PatternCheck)) {
+            if (!rule.pattern_.isValid () ||
+                    !rule.pattern_.match (s_value).hasMatch ()) {
+                b_ok = false;
+                s_expected = QString ("a match for %1")
+                        .arg (rule.pattern_.pattern ());
+            }
+        }
+
+        if (!b_ok) {
+            b_ret = false;
+            if (errors != NULL) {
+                errors->append (
+                            QString ("Option %1: %2 is not %3.")
+                            .arg (rule.key_)
+                            .arg (s_value)
+                            .arg (s_expected));
+            }
+        }
+    }
+
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Options that have no value in the table are not checked.
+ *
+ * @param table the values (see `AppOpts::table()`)
+ * @param errors messages are appended here (may be NULL)
+ * @return true if all the values are acceptable
+ */
+bool OptValidator::validate (
+        const OptTable & table, QStringList * errors) const
+{
+    APPOPTS_TRACE_SPAN("validate", QString::number (rules_.count ()));
+    bool b_ret = true;
+    for (int i = 0; i < rules_.count (); ++i) {
+        const Rule & rule = rules_.at (i);
+        const QStringList * values = table.values (
+                    table.find (rule.key_, rule.hash_));
+        if (values == NULL)
+            continue;
+        if (!check (i, *values, errors)) {
+            b_ret = false;
+        }
+    }
+    return b_ret;
+}
+/* ========================================================================= */
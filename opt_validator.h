@@ -0,0 +1,91 @@
+/**
+ * @file opt_validator.h
+ * @brief Declarations for OptValidator class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTVALIDATOR_H_INCLUDE
+#define GUARD_APPOPTS_OPTVALIDATOR_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+#include <appopts/opt_constraints.h>
+
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class OneOpt;
+class OneOptList;
+class OptTable;
+
+//! The constraints of a list of options, ready to be checked.
+class APPOPTS_EXPORT OptValidator {
+
+public:
+
+    //! Compile the constraints of the options in a list.
+    explicit OptValidator (
+            const OneOptList & list);
+
+    //! Destructor.
+    ~OptValidator ();
+
+    //! Number of options that have constraints.
+    inline int
+    count () const {
+        return rules_.count ();
+    }
+
+    //! Full name of the i-th option that has constraints.
+    inline const QString &
+    key (
+            int i) const {
+        return rules_.at (i).key_;
+    }
+
+    //! Problems found while compiling (invalid patterns).
+    inline const QStringList &
+    compileErrors () const {
+        return compile_errors_;
+    }
+
+    //! Check the values of the i-th option.
+    bool
+    check (
+            int i,
+            const QStringList & values,
+            QStringList * errors) const;
+
+    //! Check the values stored in a table for all options.
+    bool
+    validate (
+            const OptTable & table,
+            QStringList * errors) const;
+
+private:
+
+    //! The compiled form of the constraints of an option.
+    struct Rule {
+        QString key_; /**< full name of the option */
+        uint hash_; /**< hash of the full name */
+        int checks_; /**< OptConstraints::Check values */
+        qint64 int_min_; /**< smallest integer */
+        qint64 int_max_; /**< largest integer */
+        double double_min_; /**< smallest number */
+        double double_max_; /**< largest number */
+        QSet<QString> choices_; /**< acceptable strings */
+        QRegularExpression pattern_; /**< anchored expression */
+        int count_min_; /**< least number of values */
+        int count_max_; /**< most number of values */
+    };
+
+    QVector<Rule> rules_; /**< one entry for each constrained option */
+    QStringList compile_errors_; /**< invalid patterns */
+};
+
+#endif // GUARD_APPOPTS_OPTVALIDATOR_H_INCLUDE
@@ -0,0 +1,256 @@
+/**
+ * @file opt_watcher.cc
+ * @brief Definitions for OptWatcher class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "opt_watcher.h"
+#include "appopts.h"
+#include "appopts-private.h"
+#include "one_opt.h"
+#include "one_opt_list.h"
+
+#include <perst/perst_factory.h>
+#include <perst/perst.h>
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QFile>
+#include <QRunnable>
+
+/**
+ * @class OptWatcher
+ *
+ * The watcher is created by `AppOpts::setHotReload()` and lives in the
+ * thread of its owner. When one of the watched files changes only that file
+ * is parsed again, in a worker thread, and the values of the known options
+ * are read from it. The result is posted back to the owner's thread, where
+ * the layer of the file is replaced and the affected options are merged
+ * again with the current content of the other layers, in a single batch
+ * (so there is a single snapshot published); the listeners are then
+ * informed. Values set while the file was being parsed are thus never
+ * overwritten by a stale merge.
+ *
+ * Only one file is processed at a time; changes that arrive while a job is
+ * running are queued and processed afterwards.
+ */
+
+//! The type of the event carrying a result back to the watcher.
+static const QEvent::Type OPTWATCHER_RESULT_EVENT =
+        static_cast<QEvent::Type>(QEvent::User + 0x0A0);
+
+//! Event carrying a result back to the watcher.
+class OptWatcherEvent : public QEvent {
+public:
+    explicit OptWatcherEvent (const OptWatcher::Result & result) :
+        QEvent (OPTWATCHER_RESULT_EVENT),
+        result_(result)
+    {}
+    //! A result that was not applied still owns its file.
+    ~OptWatcherEvent () {
+        delete result_.perst_;
+    }
+    OptWatcher::Result result_;
+};
+
+//! Parses a file in the worker thread.
+class OptWatcherJob : public QRunnable {
+
+public:
+
+    OptWatcherJob (
+            OptWatcher * receiver,
+            const QString & s_file,
+            int cfg,
+            const OneOptList & known) :
+        QRunnable (),
+        receiver_(receiver),
+        known_(known)
+    {
+        result_.file_ = s_file;
+        result_.cfg_ = cfg;
+        result_.perst_ = NULL;
+    }
+
+    virtual void
+    run ();
+
+private:
+
+    OptWatcher * receiver_;
+    OneOptList known_;
+    OptWatcher::Result result_;
+};
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs in the worker thread; the result is always posted back.
+ */
+void OptWatcherJob::run ()
+{
+    APPOPTS_TRACE_ENTRY;
+    for (;;) {
+        if (!QFile::exists (result_.file_)) {
+            result_.error_ = QCoreApplication::translate (
+                        "AppOpts", "The file no longer exists.");
+            break;
+        }
+
+        result_.perst_ = AppOpts::parseCfgFile (
+                    result_.file_, &result_.version_, &result_.error_);
+        if (result_.perst_ == NULL) {
+            break;
+        }
+
+        // values in the new file
+        foreach (const OneOpt & opt, known_) {
+            QStringList sl;
+            if (AppOpts::valueFromPerSt (result_.perst_, opt, sl)) {
+                result_.values_.insert (opt.fullName (), sl);
+            }
+        }
+
+        break;
+    }
+
+    QCoreApplication::postEvent (receiver_, new OptWatcherEvent (result_));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param owner the instance to reload; must outlive the watcher
+ */
+OptWatcher::OptWatcher (AppOpts * owner) :
+    QObject (),
+    owner_(owner),
+    fs_watcher_(),
+    files_(),
+    pending_(),
+    busy_(false),
+    pool_()
+{
+    APPOPTS_TRACE_ENTRY;
+    pool_.setMaxThreadCount (1);
+    ChangeSink sink;
+    sink.watcher_ = this;
+    QObject::connect (&fs_watcher_, &QFileSystemWatcher::fileChanged,
+                      this, sink);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Waits for a running job; its result is discarded.
+ */
+OptWatcher::~OptWatcher ()
+{
+    APPOPTS_TRACE_ENTRY;
+    pool_.waitForDone ();
+    QCoreApplication::removePostedEvents (this, OPTWATCHER_RESULT_EVENT);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param s_file path of the file
+ * @param cfg which of the files of the owner this is (`AppOpts::CfgFile`)
+ */
+void OptWatcher::watch (const QString & s_file, int cfg)
+{
+    if (s_file.isEmpty ())
+        return;
+    files_.insert (s_file, cfg);
+    if (!fs_watcher_.files ().contains (s_file)) {
+        fs_watcher_.addPath (s_file);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The result of a job that is already running will be discarded.
+ */
+void OptWatcher::clear ()
+{
+    QStringList sl_files = fs_watcher_.files ();
+    if (!sl_files.isEmpty ()) {
+        fs_watcher_.removePaths (sl_files);
+    }
+    files_.clear ();
+    pending_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Editors often replace the file instead of writing it in place, in which
+ * case the watch is lost; the path is added back if the file exists.
+ * A change made by the write-back of the owner is not reloaded.
+ *
+ * @param s_file the path that changed
+ */
+void OptWatcher::fileChanged (const QString & s_file)
+{
+    if (!files_.contains (s_file))
+        return;
+    if (!fs_watcher_.files ().contains (s_file) && QFile::exists (s_file)) {
+        fs_watcher_.addPath (s_file);
+    }
+    if ((owner_->saver_ != NULL) && owner_->saver_->isOwnWrite (s_file))
+        return;
+
+    if (busy_) {
+        pending_.insert (s_file);
+    } else {
+        startJob (s_file);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The inputs of the job are copied from the owner here, in the owner's
+ * thread; the copies are cheap as Qt containers are implicitly shared.
+ *
+ * @param s_file the path to parse
+ */
+void OptWatcher::startJob (const QString & s_file)
+{
+    busy_ = true;
+    pool_.start (new OptWatcherJob (
+                     this, s_file, files_.value (s_file),
+                     owner_->known_));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param e the event
+ * @return true if the event was handled
+ */
+bool OptWatcher::event (QEvent * e)
+{
+    if (e->type () != OPTWATCHER_RESULT_EVENT) {
+        return QObject::event (e);
+    }
+
+    Result & result = static_cast<OptWatcherEvent*>(e)->result_;
+    busy_ = false;
+    if (files_.contains (result.file_)) {
+        owner_->applyReload (result);
+        // the owner took the file
+        result.perst_ = NULL;
+    }
+
+    if (!pending_.isEmpty ()) {
+        QString s_next = *pending_.begin ();
+        pending_.remove (s_next);
+        startJob (s_next);
+    }
+    return true;
+}
+/* ========================================================================= */
@@ -0,0 +1,124 @@
+/**
+ * @file opt_watcher.h
+ * @brief Declarations for OptWatcher class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_APPOPTS_OPTWATCHER_H_INCLUDE
+#define GUARD_APPOPTS_OPTWATCHER_H_INCLUDE
+
+#include <appopts/appopts-config.h>
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QThreadPool>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class AppOpts;
+class PerSt;
+
+//! Interface for objects interested in reloaded configuration files.
+class APPOPTS_EXPORT OptReloadListener {
+
+public:
+
+    //! Destructor.
+    virtual ~OptReloadListener () {}
+
+    //! A file was reloaded and the values of some options changed.
+    virtual void
+    optionsReloaded (
+            const QString & s_file,
+            const QStringList & sl_changed) = 0;
+
+    //! A file changed but could not be loaded.
+    virtual void
+    reloadFailed (
+            const QString & s_file,
+            const QString & s_error) {
+        Q_UNUSED(s_file);
+        Q_UNUSED(s_error);
+    }
+};
+
+//! Watches configuration files and reloads them in AppOpts.
+class APPOPTS_EXPORT OptWatcher : public QObject {
+
+public:
+
+    //! The outcome of parsing a changed file.
+    struct Result {
+        QString file_; /**< path of the file */
+        int cfg_; /**< which file of the owner (AppOpts::CfgFile) */
+        PerSt * perst_; /**< newly loaded file or NULL on error */
+        QString error_; /**< the error if perst_ is NULL */
+        QString version_; /**< perst_version in the file */
+        QHash<QString,QStringList> values_; /**< options found in file */
+    };
+
+    //! Constructor.
+    explicit OptWatcher (
+            AppOpts * owner);
+
+    //! Destructor.
+    virtual ~OptWatcher ();
+
+    //! Start watching a file of the owner.
+    void
+    watch (
+            const QString & s_file,
+            int cfg);
+
+    //! Stop watching all files.
+    void
+    clear ();
+
+protected:
+
+    //! Receives the results from the worker thread.
+    virtual bool
+    event (
+            QEvent * e);
+
+private:
+
+    //! A watched file changed on disk.
+    void
+    fileChanged (
+            const QString & s_file);
+
+    //! Start parsing a file in the worker thread.
+    void
+    startJob (
+            const QString & s_file);
+
+    //! Connects the watcher signal to fileChanged().
+    struct ChangeSink {
+        OptWatcher * watcher_;
+        void operator() (const QString & s_file) const {
+            watcher_->fileChanged (s_file);
+        }
+    };
+
+    //! not copyable
+    OptWatcher (const OptWatcher &);
+
+    //! not assignable
+    OptWatcher& operator=( const OptWatcher& );
+
+    AppOpts * owner_; /**< the instance being reloaded */
+    QFileSystemWatcher fs_watcher_; /**< the Qt watcher */
+    QMap<QString,int> files_; /**< watched files and their kind */
+    QSet<QString> pending_; /**< changed while a job was running */
+    bool busy_; /**< a job is running */
+    QThreadPool pool_; /**< the worker thread */
+};
+
+#endif // GUARD_APPOPTS_OPTWATCHER_H_INCLUDE
@@ -0,0 +1,399 @@
+/**
+ * @file appopts_test.cc
+ * @brief Unit tests for the AppOpts pile.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include <appopts/appopts.h>
+#include <appopts/opt_overrides.h>
+#include <appopts/opt_saver.h>
+#include <appopts/opt_snapshot.h>
+#include <appopts/one_opt_list.h>
+
+#include <usermsg/usermsg.h>
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+
+//! The name the tests load their files under (`appopts_test.ini`).
+#define TEST_APP_NAME "appopts_test"
+
+//! Makes a directory current and restores the previous one on exit,
+//! including an early return from a failed QVERIFY.
+class TestCurrentDir {
+public:
+    explicit TestCurrentDir (const QString & s_path) :
+        s_prev_(QDir::currentPath ())
+    {
+        QDir::setCurrent (s_path);
+    }
+    ~TestCurrentDir () {
+        QDir::setCurrent (s_prev_);
+    }
+private:
+    QString s_prev_;
+};
+
+//! Remembers every list of changes it is given.
+class TestChangeListener : public OptChangeListener {
+public:
+    virtual void optionsChanged (const QList<OptChange> & changes) {
+        calls_.append (changes);
+    }
+    QList<QList<OptChange> > calls_;
+};
+
+//! Remembers the options reported by each reload.
+class TestReloadListener : public OptReloadListener {
+public:
+    virtual void optionsReloaded (
+            const QString & s_file, const QStringList & sl_changed) {
+        Q_UNUSED(s_file);
+        changed_.append (sl_changed);
+    }
+    QList<QStringList> changed_;
+};
+
+//! Writes a configuration file with the version AppOpts expects.
+static bool writeCfg (const QString & s_path, const QString & s_body)
+{
+    QFile f (s_path);
+    if (!f.open (QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray content = QString ("[general]\nperst_version=%1\n\n%2")
+            .arg (APPOPTS_VERSION_STRING).arg (s_body).toUtf8 ();
+    return f.write (content) == content.size ();
+}
+
+//! Reads a whole file.
+static QByteArray readCfg (const QString & s_path)
+{
+    QFile f (s_path);
+    if (!f.open (QIODevice::ReadOnly))
+        return QByteArray ();
+    return f.readAll ();
+}
+
+//! Unit tests for the AppOpts pile.
+class AppOptsTest : public QObject {
+    Q_OBJECT
+
+private:
+
+    //! The schema used by the tests that read files.
+    static OneOptList
+    networkSchema () {
+        OneOptList schema;
+        schema.append ("port", "network", QString (), QStringList ("80"));
+        schema.append ("host", "network", QString (), QStringList ("a"));
+        schema.append ("verbose", "general", QString (), QStringList ("false"));
+        return schema;
+    }
+
+private slots:
+
+    //! Readers keep the table that was current when they were created.
+    void snapshotIsolation () {
+        AppOpts opts;
+        opts.setValue ("network/port", "1");
+        opts.setSnapshotMode (true);
+
+        OptSnapshot::Reader before (opts.snapshot ());
+        QCOMPARE(before.valueI ("network/port"), 1);
+
+        opts.setValue ("network/port", "2");
+        QCOMPARE(before.valueI ("network/port"), 1);
+        OptSnapshot::Reader after (opts.snapshot ());
+        QCOMPARE(after.valueI ("network/port"), 2);
+        QCOMPARE(after.valueI ("network/missing", 7), 7);
+    }
+
+    //! Staged changes are invisible until commit and gone after rollback.
+    void transactions () {
+        AppOpts opts;
+        opts.setValue ("network/port", "1");
+        opts.setValue ("network/host", "a");
+
+        QVERIFY(opts.beginTransaction ());
+        QVERIFY(opts.inTransaction ());
+        opts.setValue ("network/port", "2");
+        opts.appendValue ("network/host", "b");
+        opts.setValue ("network/port", "1");
+        QCOMPARE(opts.stagedCount (), 2);
+        QCOMPARE(opts.valueSL ("network/host"), QStringList ("a"));
+
+        QList<OptChange> changes = opts.commitTransaction ();
+        QVERIFY(!opts.inTransaction ());
+        QCOMPARE(changes.count (), 1);
+        QCOMPARE(changes.at (0).key_, QString ("network/host"));
+        QCOMPARE(changes.at (0).old_, QStringList ("a"));
+        QCOMPARE(changes.at (0).new_, QStringList () << "a" << "b");
+        QCOMPARE(opts.valueI ("network/port"), 1);
+
+        QVERIFY(opts.beginTransaction ());
+        opts.setValue ("network/port", "3");
+        opts.rollbackTransaction ();
+        QCOMPARE(opts.valueI ("network/port"), 1);
+        QCOMPARE(opts.stagedCount (), 0);
+    }
+
+    //! A file that changes is merged again and the listeners are told.
+    void hotReload () {
+        QTemporaryDir dir;
+        QString s_file = dir.path () + "/" TEST_APP_NAME ".ini";
+        QVERIFY(writeCfg (s_file, "[network]\nport=1\n"));
+        TestCurrentDir cwd (dir.path ());
+
+        AppOpts opts;
+        UserMsg um;
+        QVERIFY(opts.loadFromAll (um, TEST_APP_NAME));
+        QVERIFY(opts.readMultipleFromCfgs (networkSchema (), um));
+        QCOMPARE(opts.valueI ("network/port"), 1);
+
+        TestReloadListener listener;
+        opts.addReloadListener (&listener);
+        opts.setHotReload (true);
+        QVERIFY(writeCfg (s_file, "[network]\nport=2\n"));
+
+        // the watcher may see the truncation and the write separately
+        QTRY_COMPARE(opts.valueI ("network/port"), 2);
+        QVERIFY(!listener.changed_.isEmpty ());
+        QVERIFY(listener.changed_.last ().contains ("network/port"));
+        opts.setHotReload (false);
+        opts.removeReloadListener (&listener);
+    }
+
+    //! Changes go into the matching sections; other lines are kept.
+    void patchIni () {
+        OptSaver::Batch batch;
+        batch.changed_.insert ("network/port", QStringList ("2"));
+        batch.changed_.insert ("network/timeout", QStringList ("5"));
+        batch.changed_.insert ("fresh/key", QStringList () << "a" << "b");
+        batch.removed_.append ("network/host");
+
+        QByteArray before =
+                "; comment\n"
+                "[network]\n"
+                "port=1\n"
+                "host=a\n"
+                "\n"
+                "[other]\n"
+                "x=1\n";
+        QByteArray after =
+                "; comment\n"
+                "[network]\n"
+                "port=2\n"
+                "timeout=5\n"
+                "\n"
+                "[other]\n"
+                "x=1\n"
+                "\n"
+                "[fresh]\n"
+                "key=a, b\n";
+        QCOMPARE(OptSaver::patchIni (before, batch), after);
+
+        QByteArray crlf = QByteArray (before).replace ("\n", "\r\n");
+        QCOMPARE(OptSaver::patchIni (crlf, batch),
+                 QByteArray (after).replace ("\n", "\r\n"));
+    }
+
+    //! Values written back are read again by a new instance.
+    void writeBackRoundTrip () {
+        QTemporaryDir dir;
+        QString s_file = dir.path () + "/" TEST_APP_NAME ".ini";
+        QVERIFY(writeCfg (s_file, "; kept\n[network]\nport=1\nhost=a\n"));
+        TestCurrentDir cwd (dir.path ());
+
+        {
+            AppOpts opts;
+            UserMsg um;
+            QVERIFY(opts.loadFromAll (um, TEST_APP_NAME));
+            QVERIFY(opts.readMultipleFromCfgs (networkSchema (), um));
+            QVERIFY(opts.setCurrentConfig ("local", um));
+            opts.setWriteBack (true, 0, false);
+            opts.setValue ("network/port", "3");
+            opts.setValue ("network/host", QStringList () << "b" << "c");
+            QVERIFY(opts.saveChanges (um));
+            opts.setWriteBack (false);
+        }
+        QVERIFY(readCfg (s_file).contains ("; kept\n"));
+
+        AppOpts opts;
+        UserMsg um;
+        QVERIFY(opts.loadFromAll (um, TEST_APP_NAME));
+        QVERIFY(opts.readMultipleFromCfgs (networkSchema (), um));
+        QCOMPARE(opts.valueI ("network/port"), 3);
+        QCOMPARE(opts.valueSL ("network/host"), QStringList () << "b" << "c");
+    }
+
+    //! In lazy mode getters and appends read missing options from files.
+    void lazyLoad () {
+        QTemporaryDir dir;
+        QVERIFY(writeCfg (dir.path () + "/" TEST_APP_NAME ".ini",
+                          "[network]\nport=1\nhost=a, b\n"));
+        TestCurrentDir cwd (dir.path ());
+
+        AppOpts opts;
+        UserMsg um;
+        opts.setLazyLoad (true);
+        QVERIFY(opts.loadFromAll (um, TEST_APP_NAME));
+        QVERIFY(!opts.contains ("network/port"));
+
+        QCOMPARE(opts.valueI ("network/port"), 1);
+        QVERIFY(opts.keysInGroup ("network").contains ("network/port"));
+        QCOMPARE(opts.valueI ("network/missing", 9), 9);
+
+        opts.appendValue ("network/host", "c");
+        QCOMPARE(opts.valueSL ("network/host"),
+                 QStringList () << "a" << "b" << "c");
+    }
+
+    //! Values outside the constraints of their definitions are reported.
+    void validation () {
+        OneOptList schema;
+        schema.emplace ("port", "network").setIntRange (1, 65535);
+        schema.emplace ("mode", "network").setChoices (
+                    QStringList () << "fast" << "safe");
+
+        AppOpts opts;
+        UserMsg um;
+        opts.setValue ("network/port", "80");
+        opts.setValue ("network/mode", "safe");
+        QVERIFY(opts.validate (schema, um));
+
+        opts.setValue ("network/port", "70000");
+        QVERIFY(!opts.validate (schema, um));
+        opts.setValue ("network/port", "80");
+        opts.setValue ("network/mode", "slow");
+        QVERIFY(!opts.validate (schema, um));
+    }
+
+    //! Listeners get one call per change or per transaction.
+    void changeDelivery () {
+        AppOpts opts;
+        opts.setValue ("network/port", "1");
+        TestChangeListener by_key;
+        TestChangeListener by_group;
+        opts.subscribe ("network/port", &by_key);
+        opts.subscribeGroup ("network", &by_group);
+
+        opts.setValue ("network/port", "2");
+        opts.setValue ("general/verbose", "true");
+        QCOMPARE(by_key.calls_.count (), 1);
+        QCOMPARE(by_key.calls_.at (0).at (0).old_, QStringList ("1"));
+        QCOMPARE(by_key.calls_.at (0).at (0).new_, QStringList ("2"));
+        QCOMPARE(by_group.calls_.count (), 1);
+
+        QVERIFY(opts.beginTransaction ());
+        opts.setValue ("network/port", "3");
+        opts.setValue ("network/host", "b");
+        opts.commitTransaction ();
+        QCOMPARE(by_group.calls_.count (), 2);
+        QCOMPARE(by_group.calls_.at (1).count (), 2);
+
+        opts.unsubscribe (&by_key);
+        opts.unsubscribe (&by_group);
+        opts.setValue ("network/port", "4");
+        QCOMPARE(by_key.calls_.count (), 2);
+        QCOMPARE(by_group.calls_.count (), 2);
+    }
+
+    //! Queued listeners get the changes merged, on request or from the loop.
+    void queuedDelivery () {
+        AppOpts opts;
+        opts.setValue ("network/port", "1");
+        TestChangeListener listener;
+        opts.subscribe ("network/port", &listener, OptChanges::QueuedDelivery);
+
+        opts.setValue ("network/port", "2");
+        opts.setValue ("network/port", "3");
+        QCOMPARE(listener.calls_.count (), 0);
+        opts.deliverChanges ();
+        QCOMPARE(listener.calls_.count (), 1);
+        QCOMPARE(listener.calls_.at (0).count (), 1);
+        QCOMPARE(listener.calls_.at (0).at (0).old_, QStringList ("1"));
+        QCOMPARE(listener.calls_.at (0).at (0).new_, QStringList ("3"));
+
+        // a value that changed back is not reported
+        opts.setValue ("network/port", "4");
+        opts.setValue ("network/port", "3");
+        opts.deliverChanges ();
+        QCOMPARE(listener.calls_.count (), 1);
+
+        opts.setValue ("network/port", "5");
+        QTRY_COMPARE(listener.calls_.count (), 2);
+        opts.unsubscribe (&listener);
+    }
+
+    //! The rules of OptOverrides that callers rely on.
+    void overrides () {
+        OneOptList schema = networkSchema ();
+        QStringList args;
+        args << "test" << "--network/port=1" << "--general/verbose"
+             << "--" << "--network/host=b" << "file";
+        QStringList env;
+        env << "TEST_NETWORK_PORT=2" << "TEST_NETWORK_HOST=c";
+
+        // `--` ends the options; what follows is positional
+        OptOverrides ov (schema, "test");
+        QVERIFY(ov.parseArguments (args));
+        QCOMPARE(ov.values ().value ("network/port"), QStringList ("1"));
+        QCOMPARE(ov.values ().value ("general/verbose"), QStringList ("true"));
+        QVERIFY(!ov.values ().contains ("network/host"));
+        QCOMPARE(ov.positional (),
+                 QStringList () << "--network/host=b" << "file");
+
+        // a repeated argument collects the values
+        ov.clear ();
+        QVERIFY(ov.parseArguments (QStringList () << "test"
+                                   << "--network/host=x" << "--network/host=y"));
+        QCOMPARE(ov.values ().value ("network/host"),
+                 QStringList () << "x" << "y");
+
+        // arguments win over the environment in either order
+        OptOverrides args_first (schema, "test");
+        QVERIFY(args_first.parseArguments (args));
+        args_first.parseEnvironment (env);
+        OptOverrides env_first (schema, "test");
+        env_first.parseEnvironment (env);
+        QVERIFY(env_first.parseArguments (args));
+        QCOMPARE(args_first.values ().value ("network/port"), QStringList ("1"));
+        QCOMPARE(env_first.values ().value ("network/port"), QStringList ("1"));
+        QCOMPARE(args_first.values ().value ("network/host"), QStringList ("c"));
+        QCOMPARE(env_first.values ().value ("network/host"), QStringList ("c"));
+
+        // unknown options are kept for the caller
+        ov.clear ();
+        QVERIFY(!ov.parseArguments (QStringList () << "test" << "--nope=1"));
+        QCOMPARE(ov.unknown (), QStringList ("--nope=1"));
+    }
+
+    //! Overrides beat the files but not the application.
+    void overridesLayer () {
+        AppOpts opts;
+        UserMsg um;
+        QStringList args;
+        args << "test" << "--network/port=1" << "--style=fusion";
+
+        QVERIFY(opts.loadOverrides (networkSchema (), args, um, "test"));
+        QCOMPARE(opts.valueI ("network/port"), 1);
+        QCOMPARE(opts.valueOrigin ("network/port"),
+                 (int)OptLayers::CommandLineLayer);
+        QVERIFY(!opts.loadOverrides (networkSchema (), args, um, "test", true));
+
+        opts.setValue ("network/port", "2");
+        QCOMPARE(opts.valueOrigin ("network/port"),
+                 (int)OptLayers::RuntimeLayer);
+        opts.dropLayer (OptLayers::RuntimeLayer);
+        QCOMPARE(opts.valueI ("network/port"), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(AppOptsTest)
+#include "appopts_test.moc"